@@ -1,11 +1,19 @@
 #include "vulkan_app/vulkan_app.hpp"
+#include "vulkan_app/benchmark.hpp"
 
 int main(int argv, char** args) 
 {
-    VulkanApp app;
-
     try 
     {
+        AppOptions options = parseOptions(argv, args);
+
+        if (options.benchImport)
+        {
+            runImportBenchmark(MODEL_PATH);
+            return EXIT_SUCCESS;
+        }
+
+        VulkanApp app(options);
         app.run();
     } 
     catch (const std::exception& e) 
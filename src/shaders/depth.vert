@@ -0,0 +1,44 @@
+#version 450
+
+layout(binding = 0) uniform UniformBufferObject
+{
+    mat4 viewProj;
+} ubo;
+
+// model matrices of the frame, MAX_SCENE_OBJECTS on the cpu side
+layout(binding = 3) uniform ObjectTransforms
+{
+    mat4 models[256];
+} objects;
+
+layout(push_constant) uniform DrawConstants
+{
+    uint objectIndex;
+} draw;
+
+// OBJECT_INDEX_FROM_INSTANCE on the cpu side
+const uint OBJECT_INDEX_FROM_INSTANCE = 0xffffffffu;
+
+struct MeshData
+{
+    vec4 positionOffset;
+    vec4 positionScale;
+};
+
+layout(std430, binding = 2) readonly buffer MeshDataBuffer
+{
+    MeshData meshes[];
+};
+
+// position-only stream, nothing else is fetched
+layout(location = 0) in vec3 inPosition;
+
+invariant gl_Position;
+
+void main()
+{
+    MeshData mesh = meshes[gl_InstanceIndex];
+    vec3 position = mesh.positionOffset.xyz + inPosition * mesh.positionScale.xyz;
+    uint objectIndex = draw.objectIndex == OBJECT_INDEX_FROM_INSTANCE ? uint(gl_InstanceIndex) : draw.objectIndex;
+    gl_Position = ubo.viewProj * (objects.models[objectIndex] * vec4(position, 1.0));
+}
@@ -1,12 +1,28 @@
 #version 450
 
+// compiled with and without, the pipeline picks the SPIR-V by its feature bits
+// variant TEXTURED
+
+// set when the pipeline is created, the compiler folds the test away
+layout(constant_id = 0) const bool ALPHA_TEST = false;
+
+#ifdef TEXTURED
 layout(binding = 1) uniform sampler2D texSampler;
+#endif
 
-layout(location = 0) in vec3 fragColor;
 layout(location = 1) in vec2 fragTexCoord;
 
 layout(location = 0) out vec4 outColor;
 
 void main() {
+#ifdef TEXTURED
     outColor = texture(texSampler, fragTexCoord);
+#else
+    outColor = vec4(0.8, 0.8, 0.8, 1.0);
+#endif
+
+    if (ALPHA_TEST && outColor.a < 0.5)
+    {
+        discard;
+    }
 }
\ No newline at end of file
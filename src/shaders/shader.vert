@@ -2,21 +2,49 @@
 
 layout(binding = 0) uniform UniformBufferObject
 {
-    mat4 model;
-    mat4 view;
-    mat4 proj;
+    mat4 viewProj;
 } ubo;
 
+// model matrices of the frame, MAX_SCENE_OBJECTS on the cpu side
+layout(binding = 3) uniform ObjectTransforms
+{
+    mat4 models[256];
+} objects;
+
+layout(push_constant) uniform DrawConstants
+{
+    uint objectIndex;
+} draw;
+
+// OBJECT_INDEX_FROM_INSTANCE on the cpu side
+const uint OBJECT_INDEX_FROM_INSTANCE = 0xffffffffu;
+
+// compact vertices store positions relative to the bounds of their mesh,
+// full vertices use a zero offset and a unit scale
+struct MeshData
+{
+    vec4 positionOffset;
+    vec4 positionScale;
+};
+
+layout(std430, binding = 2) readonly buffer MeshDataBuffer
+{
+    MeshData meshes[];
+};
+
 layout(location = 0) in vec3 inPosition;
-layout(location = 1) in vec3 inColor;
 layout(location = 2) in vec2 inTexCoord;
 
-layout(location = 0) out vec3 fragColor;
 layout(location = 1) out vec2 fragTexCoord;
 
+// must match the depth pre-pass bit for bit
+invariant gl_Position;
+
 void main()
 {
-    gl_Position = ubo.proj * ubo.view * ubo.model * vec4(inPosition, 1.0);
-    fragColor = inColor;
+    MeshData mesh = meshes[gl_InstanceIndex];
+    vec3 position = mesh.positionOffset.xyz + inPosition * mesh.positionScale.xyz;
+    uint objectIndex = draw.objectIndex == OBJECT_INDEX_FROM_INSTANCE ? uint(gl_InstanceIndex) : draw.objectIndex;
+    gl_Position = ubo.viewProj * (objects.models[objectIndex] * vec4(position, 1.0));
     fragTexCoord = inTexCoord;
 }
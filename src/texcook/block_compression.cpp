@@ -0,0 +1,312 @@
+#include "block_compression.hpp"
+
+#include "stb_dxt.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+// interpolation weights of the 4-bit indices, out of 64
+static const uint32_t BC7_WEIGHTS4[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+// least squares refits of the endpoints after the first index assignment
+static const uint32_t BC7_REFINE_ITERATIONS = 2;
+
+uint32_t blockSize(BlockFormat format)
+{
+    return format == BlockFormat::BC1 ? 8 : 16;
+}
+
+void encodeBc1Block(const uint8_t* texels, uint8_t* block)
+{
+    stb_compress_dxt_block(block, texels, 0, STB_DXT_HIGHQUAL);
+}
+
+// bc7 mode 6: one subset, 7-bit rgba endpoints with a p-bit each and 4-bit indices
+struct Bc7Mode6Block
+{
+    uint8_t endpoints[2][4];
+    uint8_t pbits[2];
+    uint8_t indices[16];
+    uint32_t error;
+};
+
+static void quantizeEndpoints(const float endpoints[2][4], uint8_t pbit0, uint8_t pbit1, Bc7Mode6Block& block)
+{
+    block.pbits[0] = pbit0;
+    block.pbits[1] = pbit1;
+    for (uint32_t e = 0; e < 2; ++e)
+    {
+        for (uint32_t c = 0; c < 4; ++c)
+        {
+            float value = std::round((endpoints[e][c] - block.pbits[e]) * 0.5f);
+            block.endpoints[e][c] = static_cast<uint8_t>(std::clamp(value, 0.f, 127.f));
+        }
+    }
+}
+
+// picks the closest palette entry for every texel, returns the total squared error
+static uint32_t fitIndices(const uint8_t* texels, Bc7Mode6Block& block)
+{
+    int32_t palette[16][4];
+    for (uint32_t c = 0; c < 4; ++c)
+    {
+        int32_t e0 = block.endpoints[0][c] * 2 + block.pbits[0];
+        int32_t e1 = block.endpoints[1][c] * 2 + block.pbits[1];
+        for (uint32_t i = 0; i < 16; ++i)
+        {
+            palette[i][c] = (e0 * (64 - BC7_WEIGHTS4[i]) + e1 * BC7_WEIGHTS4[i] + 32) >> 6;
+        }
+    }
+
+    uint32_t totalError = 0;
+    for (uint32_t t = 0; t < 16; ++t)
+    {
+        const uint8_t* texel = texels + t * 4;
+        uint32_t bestError = UINT32_MAX;
+        for (uint32_t i = 0; i < 16; ++i)
+        {
+            uint32_t error = 0;
+            for (uint32_t c = 0; c < 4; ++c)
+            {
+                int32_t d = palette[i][c] - texel[c];
+                error += static_cast<uint32_t>(d * d);
+            }
+            if (error < bestError)
+            {
+                bestError = error;
+                block.indices[t] = static_cast<uint8_t>(i);
+            }
+        }
+        totalError += bestError;
+    }
+
+    block.error = totalError;
+    return totalError;
+}
+
+// tries every p-bit combination for the endpoints, keeps the best block
+static void fitEndpoints(const uint8_t* texels, const float endpoints[2][4], Bc7Mode6Block& best)
+{
+    for (uint8_t p = 0; p < 4; ++p)
+    {
+        Bc7Mode6Block candidate;
+        quantizeEndpoints(endpoints, p & 1, p >> 1, candidate);
+        if (fitIndices(texels, candidate) < best.error)
+        {
+            best = candidate;
+        }
+    }
+}
+
+// endpoints along the principal axis of the texel colors
+static void principalEndpoints(const uint8_t* texels, float endpoints[2][4])
+{
+    float mean[4] = {};
+    for (uint32_t t = 0; t < 16; ++t)
+    {
+        for (uint32_t c = 0; c < 4; ++c)
+        {
+            mean[c] += texels[t * 4 + c] / 16.f;
+        }
+    }
+
+    float covariance[4][4] = {};
+    for (uint32_t t = 0; t < 16; ++t)
+    {
+        float d[4];
+        for (uint32_t c = 0; c < 4; ++c)
+        {
+            d[c] = texels[t * 4 + c] - mean[c];
+        }
+        for (uint32_t i = 0; i < 4; ++i)
+        {
+            for (uint32_t j = 0; j < 4; ++j)
+            {
+                covariance[i][j] += d[i] * d[j];
+            }
+        }
+    }
+
+    // power iteration, started from the channel spread
+    float axis[4] = {1.f, 1.f, 1.f, 1.f};
+    for (uint32_t iteration = 0; iteration < 8; ++iteration)
+    {
+        float next[4] = {};
+        for (uint32_t i = 0; i < 4; ++i)
+        {
+            for (uint32_t j = 0; j < 4; ++j)
+            {
+                next[i] += covariance[i][j] * axis[j];
+            }
+        }
+
+        float length = std::sqrt(next[0] * next[0] + next[1] * next[1] + next[2] * next[2] + next[3] * next[3]);
+        if (length < 1e-6f)
+        {
+            break;
+        }
+        for (uint32_t c = 0; c < 4; ++c)
+        {
+            axis[c] = next[c] / length;
+        }
+    }
+
+    float minProjection = 0.f;
+    float maxProjection = 0.f;
+    for (uint32_t t = 0; t < 16; ++t)
+    {
+        float projection = 0.f;
+        for (uint32_t c = 0; c < 4; ++c)
+        {
+            projection += (texels[t * 4 + c] - mean[c]) * axis[c];
+        }
+        minProjection = std::min(minProjection, projection);
+        maxProjection = std::max(maxProjection, projection);
+    }
+
+    for (uint32_t c = 0; c < 4; ++c)
+    {
+        endpoints[0][c] = std::clamp(mean[c] + axis[c] * minProjection, 0.f, 255.f);
+        endpoints[1][c] = std::clamp(mean[c] + axis[c] * maxProjection, 0.f, 255.f);
+    }
+}
+
+// least squares endpoints for the current indices, false when every texel uses the same weight
+static bool refitEndpoints(const uint8_t* texels, const Bc7Mode6Block& block, float endpoints[2][4])
+{
+    float aa = 0.f;
+    float ab = 0.f;
+    float bb = 0.f;
+    float ax[4] = {};
+    float bx[4] = {};
+    for (uint32_t t = 0; t < 16; ++t)
+    {
+        float b = BC7_WEIGHTS4[block.indices[t]] / 64.f;
+        float a = 1.f - b;
+        aa += a * a;
+        ab += a * b;
+        bb += b * b;
+        for (uint32_t c = 0; c < 4; ++c)
+        {
+            ax[c] += a * texels[t * 4 + c];
+            bx[c] += b * texels[t * 4 + c];
+        }
+    }
+
+    float determinant = aa * bb - ab * ab;
+    if (std::abs(determinant) < 1e-6f)
+    {
+        return false;
+    }
+
+    for (uint32_t c = 0; c < 4; ++c)
+    {
+        endpoints[0][c] = std::clamp((ax[c] * bb - bx[c] * ab) / determinant, 0.f, 255.f);
+        endpoints[1][c] = std::clamp((bx[c] * aa - ax[c] * ab) / determinant, 0.f, 255.f);
+    }
+    return true;
+}
+
+class BitWriter
+{
+public:
+    explicit BitWriter(uint8_t* data) : data(data) { memset(data, 0, 16); }
+
+    void write(uint32_t value, uint32_t bitCount)
+    {
+        for (uint32_t i = 0; i < bitCount; ++i, ++position)
+        {
+            data[position / 8] |= static_cast<uint8_t>(((value >> i) & 1) << (position % 8));
+        }
+    }
+
+private:
+    uint8_t* data;
+    uint32_t position = 0;
+};
+
+void encodeBc7Block(const uint8_t* texels, uint8_t* block)
+{
+    float endpoints[2][4];
+    principalEndpoints(texels, endpoints);
+
+    Bc7Mode6Block best{};
+    best.error = UINT32_MAX;
+    fitEndpoints(texels, endpoints, best);
+
+    for (uint32_t iteration = 0; iteration < BC7_REFINE_ITERATIONS && best.error > 0; ++iteration)
+    {
+        if (!refitEndpoints(texels, best, endpoints))
+        {
+            break;
+        }
+        fitEndpoints(texels, endpoints, best);
+    }
+
+    // the top bit of the first index is implied zero, swap the endpoints to clear it
+    if (best.indices[0] >= 8)
+    {
+        for (uint32_t c = 0; c < 4; ++c)
+        {
+            std::swap(best.endpoints[0][c], best.endpoints[1][c]);
+        }
+        std::swap(best.pbits[0], best.pbits[1]);
+        for (uint32_t t = 0; t < 16; ++t)
+        {
+            best.indices[t] = static_cast<uint8_t>(15 - best.indices[t]);
+        }
+    }
+
+    BitWriter writer(block);
+    writer.write(1 << 6, 7);
+    for (uint32_t c = 0; c < 4; ++c)
+    {
+        writer.write(best.endpoints[0][c], 7);
+        writer.write(best.endpoints[1][c], 7);
+    }
+    writer.write(best.pbits[0], 1);
+    writer.write(best.pbits[1], 1);
+    writer.write(best.indices[0], 3);
+    for (uint32_t t = 1; t < 16; ++t)
+    {
+        writer.write(best.indices[t], 4);
+    }
+}
+
+std::vector<uint8_t> compressImage(BlockFormat format, const uint8_t* rgba, uint32_t width, uint32_t height, ThreadPool& pool)
+{
+    uint32_t blocksX = (width + 3) / 4;
+    uint32_t blocksY = (height + 3) / 4;
+    uint32_t size = blockSize(format);
+    std::vector<uint8_t> blocks(static_cast<size_t>(blocksX) * blocksY * size);
+
+    // one task per row of blocks
+    pool.parallelFor(blocksY, [&](uint32_t by)
+    {
+        uint8_t texels[16 * 4];
+        for (uint32_t bx = 0; bx < blocksX; ++bx)
+        {
+            for (uint32_t y = 0; y < 4; ++y)
+            {
+                for (uint32_t x = 0; x < 4; ++x)
+                {
+                    uint32_t sx = std::min(bx * 4 + x, width - 1);
+                    uint32_t sy = std::min(by * 4 + y, height - 1);
+                    memcpy(texels + (y * 4 + x) * 4, rgba + (static_cast<size_t>(sy) * width + sx) * 4, 4);
+                }
+            }
+
+            uint8_t* block = blocks.data() + (static_cast<size_t>(by) * blocksX + bx) * size;
+            if (format == BlockFormat::BC1)
+            {
+                encodeBc1Block(texels, block);
+            }
+            else
+            {
+                encodeBc7Block(texels, block);
+            }
+        }
+    });
+
+    return blocks;
+}
\ No newline at end of file
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include "thread_pool.hpp"
+
+enum class BlockFormat
+{
+    BC1,
+    BC7
+};
+
+// bytes of one encoded 4x4 block
+uint32_t blockSize(BlockFormat format);
+
+// encodes 16 rgba8 texels given row by row
+void encodeBc1Block(const uint8_t* texels, uint8_t* block);
+void encodeBc7Block(const uint8_t* texels, uint8_t* block);
+
+// edges of images whose size is not a multiple of four are padded by repeating the last row and column
+std::vector<uint8_t> compressImage(BlockFormat format, const uint8_t* rgba, uint32_t width, uint32_t height, ThreadPool& pool);
\ No newline at end of file
@@ -0,0 +1,220 @@
+// offline texture cooker: source image -> block-compressed mip chain in a ktx2 container
+#include "block_compression.hpp"
+#include "ktx2.hpp"
+#include "thread_pool.hpp"
+#include "stb_image.h"
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <filesystem>
+#include <stdexcept>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+struct CookOptions
+{
+    std::string inputPath;
+    std::string outputPath;
+    BlockFormat format = BlockFormat::BC7;
+    bool srgb = true;
+    uint32_t workerThreads = 0;
+};
+
+static void printUsage()
+{
+    printf("usage: texcook <input image> [output.ktx2] [--format bc7|bc1] [--linear] [--worker-threads N]\n");
+}
+
+static CookOptions parseCookOptions(int argc, char** argv)
+{
+    CookOptions options{};
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+
+        if (arg == "--format" || arg == "--worker-threads")
+        {
+            if (i + 1 >= argc)
+            {
+                throw std::invalid_argument("missing value for " + arg);
+            }
+            std::string value = argv[++i];
+            if (arg == "--worker-threads")
+            {
+                options.workerThreads = static_cast<uint32_t>(std::stoul(value));
+            }
+            else if (value == "bc7")
+            {
+                options.format = BlockFormat::BC7;
+            }
+            else if (value == "bc1")
+            {
+                options.format = BlockFormat::BC1;
+            }
+            else
+            {
+                throw std::invalid_argument("unknown format " + value);
+            }
+        }
+        else if (arg == "--linear")
+        {
+            options.srgb = false;
+        }
+        else if (options.inputPath.empty())
+        {
+            options.inputPath = arg;
+        }
+        else if (options.outputPath.empty())
+        {
+            options.outputPath = arg;
+        }
+        else
+        {
+            throw std::invalid_argument("unexpected argument " + arg);
+        }
+    }
+
+    if (options.inputPath.empty())
+    {
+        printUsage();
+        throw std::invalid_argument("missing input image");
+    }
+
+    // the runtime looks for the cooked texture next to the source
+    if (options.outputPath.empty())
+    {
+        options.outputPath = std::filesystem::path(options.inputPath).replace_extension(".ktx2").string();
+    }
+
+    return options;
+}
+
+static VkFormat vulkanFormat(const CookOptions& options)
+{
+    if (options.format == BlockFormat::BC1)
+    {
+        return options.srgb ? VK_FORMAT_BC1_RGB_SRGB_BLOCK : VK_FORMAT_BC1_RGB_UNORM_BLOCK;
+    }
+    return options.srgb ? VK_FORMAT_BC7_SRGB_BLOCK : VK_FORMAT_BC7_UNORM_BLOCK;
+}
+
+static float srgbToLinear(uint8_t value)
+{
+    float c = value / 255.f;
+    return c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+}
+
+static uint8_t linearToSrgb(float value)
+{
+    float c = value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.f / 2.4f) - 0.055f;
+    return static_cast<uint8_t>(std::clamp(c * 255.f + 0.5f, 0.f, 255.f));
+}
+
+// 2x2 box filter, color is averaged in linear light for srgb textures and alpha always linearly
+static std::vector<uint8_t> downsample(const std::vector<uint8_t>& source, uint32_t width, uint32_t height, bool srgb)
+{
+    uint32_t nextWidth = std::max(width / 2, 1u);
+    uint32_t nextHeight = std::max(height / 2, 1u);
+    std::vector<uint8_t> result(static_cast<size_t>(nextWidth) * nextHeight * 4);
+
+    for (uint32_t y = 0; y < nextHeight; ++y)
+    {
+        for (uint32_t x = 0; x < nextWidth; ++x)
+        {
+            uint32_t x0 = std::min(x * 2, width - 1);
+            uint32_t x1 = std::min(x * 2 + 1, width - 1);
+            uint32_t y0 = std::min(y * 2, height - 1);
+            uint32_t y1 = std::min(y * 2 + 1, height - 1);
+            const uint8_t* texels[4] = {
+                &source[(static_cast<size_t>(y0) * width + x0) * 4],
+                &source[(static_cast<size_t>(y0) * width + x1) * 4],
+                &source[(static_cast<size_t>(y1) * width + x0) * 4],
+                &source[(static_cast<size_t>(y1) * width + x1) * 4]};
+
+            uint8_t* target = &result[(static_cast<size_t>(y) * nextWidth + x) * 4];
+            for (uint32_t c = 0; c < 4; ++c)
+            {
+                bool gamma = srgb && c < 3;
+                float sum = 0.f;
+                for (const uint8_t* texel : texels)
+                {
+                    sum += gamma ? srgbToLinear(texel[c]) : texel[c];
+                }
+                target[c] = gamma ? linearToSrgb(sum * 0.25f) : static_cast<uint8_t>((sum + 2.f) * 0.25f);
+            }
+        }
+    }
+
+    return result;
+}
+
+int main(int argc, char** argv)
+{
+    try
+    {
+        CookOptions options = parseCookOptions(argc, argv);
+        auto start = std::chrono::high_resolution_clock::now();
+
+        int width, height, channels;
+        stbi_uc* pixels = stbi_load(options.inputPath.c_str(), &width, &height, &channels, STBI_rgb_alpha);
+        if (!pixels)
+        {
+            throw std::runtime_error("failed to load " + options.inputPath + "!");
+        }
+
+        std::vector<uint8_t> image(pixels, pixels + static_cast<size_t>(width) * height * 4);
+        stbi_image_free(pixels);
+
+        if (options.format == BlockFormat::BC1 && channels == 4)
+        {
+            printf("warning: bc1 drops the alpha channel of %s\n", options.inputPath.c_str());
+        }
+
+        // full chain down to 1x1
+        uint32_t levelCount = static_cast<uint32_t>(std::floor(std::log2(std::max(width, height)))) + 1;
+        uint32_t levelWidth = static_cast<uint32_t>(width);
+        uint32_t levelHeight = static_cast<uint32_t>(height);
+
+        ThreadPool pool(options.workerThreads);
+        std::vector<std::vector<uint8_t>> levels;
+        size_t sourceSize = 0;
+        for (uint32_t i = 0; i < levelCount; ++i)
+        {
+            sourceSize += image.size();
+            levels.push_back(compressImage(options.format, image.data(), levelWidth, levelHeight, pool));
+
+            if (i + 1 < levelCount)
+            {
+                image = downsample(image, levelWidth, levelHeight, options.srgb);
+                levelWidth = std::max(levelWidth / 2, 1u);
+                levelHeight = std::max(levelHeight / 2, 1u);
+            }
+        }
+
+        if (!writeKtx2(options.outputPath, vulkanFormat(options), static_cast<uint32_t>(width), static_cast<uint32_t>(height), levels))
+        {
+            throw std::runtime_error("failed to write " + options.outputPath + "!");
+        }
+
+        size_t cookedSize = 0;
+        for (const auto& level : levels)
+        {
+            cookedSize += level.size();
+        }
+
+        double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+        printf("%s: %dx%d, %u levels, %s, %.1f KiB -> %.1f KiB in %.2f s\n", options.outputPath.c_str(), width, height, levelCount,
+            options.format == BlockFormat::BC7 ? "bc7" : "bc1", sourceSize / 1024.0, cookedSize / 1024.0, seconds);
+    }
+    catch (const std::exception& e)
+    {
+        fprintf(stderr, "%s\n", e.what());
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
\ No newline at end of file
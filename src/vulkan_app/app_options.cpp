@@ -0,0 +1,156 @@
+#include "app_options.hpp"
+
+#include <string>
+#include <stdexcept>
+#include <algorithm>
+
+#include "packed_geometry.hpp"
+#include "frame_scheduler.hpp"
+
+#include <SDL2/SDL.h>
+
+static uint32_t parseCount(int& i, int argc, char** argv)
+{
+    if (i + 1 >= argc)
+    {
+        throw std::invalid_argument(std::string("missing value for ") + argv[i]);
+    }
+    return static_cast<uint32_t>(std::stoul(argv[++i]));
+}
+
+static float parseFloat(int& i, int argc, char** argv)
+{
+    if (i + 1 >= argc)
+    {
+        throw std::invalid_argument(std::string("missing value for ") + argv[i]);
+    }
+    return std::stof(argv[++i]);
+}
+
+AppOptions parseOptions(int argc, char** argv)
+{
+    AppOptions options{};
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+
+        if (arg == "--worker-threads")
+        {
+            options.workerThreads = parseCount(i, argc, argv);
+        }
+        else if (arg == "--bench-import")
+        {
+            options.benchImport = true;
+        }
+        else if (arg == "--depth-prepass")
+        {
+            options.depthPrepass = true;
+        }
+        else if (arg == "--cluster-culling")
+        {
+            if (i + 1 >= argc)
+            {
+                throw std::invalid_argument("missing value for " + arg);
+            }
+            std::string mode = argv[++i];
+            if (mode == "off")
+            {
+                options.clusterCulling = ClusterCulling::Off;
+            }
+            else if (mode == "cpu")
+            {
+                options.clusterCulling = ClusterCulling::Cpu;
+            }
+            else if (mode == "gpu")
+            {
+                options.clusterCulling = ClusterCulling::Gpu;
+            }
+            else
+            {
+                throw std::invalid_argument("unknown cluster culling mode " + mode);
+            }
+        }
+        else if (arg == "--frames-in-flight")
+        {
+            options.framesInFlight = parseCount(i, argc, argv);
+            if (options.framesInFlight < 1 || options.framesInFlight > MAX_FRAMES_IN_FLIGHT)
+            {
+                throw std::invalid_argument("frames in flight must be between 1 and " + std::to_string(MAX_FRAMES_IN_FLIGHT));
+            }
+        }
+        else if (arg == "--parallel-recording")
+        {
+            options.parallelRecording = true;
+        }
+        else if (arg == "--cache-commands")
+        {
+            options.cacheCommands = true;
+        }
+        else if (arg == "--cold-pipeline-cache")
+        {
+            options.coldPipelineCache = true;
+        }
+        else if (arg == "--dump-render-graph")
+        {
+            options.dumpRenderGraph = true;
+        }
+        else if (arg == "--bench-recording")
+        {
+            options.benchRecording = true;
+        }
+        else if (arg == "--no-upload-batching")
+        {
+            options.uploadBatching = false;
+        }
+        else if (arg == "--no-weld")
+        {
+            options.meshProcessing.weld = false;
+        }
+        else if (arg == "--weld-epsilon")
+        {
+            options.meshProcessing.weldEpsilon = parseFloat(i, argc, argv);
+        }
+        else if (arg == "--no-index-opt")
+        {
+            options.meshProcessing.optimizeIndices = false;
+        }
+        else if (arg == "--no-meshlets")
+        {
+            options.meshProcessing.buildMeshlets = false;
+        }
+        else if (arg == "--lod-levels")
+        {
+            options.meshProcessing.lodLevels = std::min(parseCount(i, argc, argv), MAX_MESH_LODS - 1);
+        }
+        else if (arg == "--lod-pixel-error")
+        {
+            options.lodPixelError = parseFloat(i, argc, argv);
+        }
+        else if (arg == "--compact-vertices")
+        {
+            options.meshProcessing.vertexFormat = VertexFormat::Compact;
+        }
+        else if (arg == "--untextured")
+        {
+            options.textured = false;
+        }
+        else if (arg == "--alpha-test")
+        {
+            options.alphaTest = true;
+        }
+        else
+        {
+            throw std::invalid_argument("unknown option " + arg);
+        }
+    }
+
+    // the position-only pre-pass has no fragment stage to discard in, it would hide what the cut-outs show
+    if (options.alphaTest && options.depthPrepass)
+    {
+        SDL_Log("--alpha-test disables --depth-prepass");
+        options.depthPrepass = false;
+    }
+
+    return options;
+}
\ No newline at end of file
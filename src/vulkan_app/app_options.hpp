@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstdint>
+
+#include "vertex_data.hpp"
+
+// steps run on freshly imported meshes before they are packed and cached
+struct MeshProcessOptions
+{
+    bool weld = true;
+    // 0 welds bit-identical vertices only
+    float weldEpsilon = 0.f;
+    // vertex cache, overdraw and vertex fetch ordering
+    bool optimizeIndices = true;
+    // quantized positions and half float texture coordinates
+    VertexFormat vertexFormat = VertexFormat::Full;
+    // clusters of at most MESHLET_MAX_VERTICES vertices and MESHLET_MAX_TRIANGLES triangles
+    bool buildMeshlets = true;
+    // simplified levels of detail generated below the full mesh
+    uint32_t lodLevels = 4;
+};
+
+// where clusters that are off-screen or face away from the camera are dropped
+enum class ClusterCulling
+{
+    Off,
+    Cpu,
+    Gpu
+};
+
+struct AppOptions
+{
+    // 0 uses every hardware thread
+    uint32_t workerThreads = 0;
+    bool benchImport = false;
+    // lay down depth from a position-only stream before shading
+    bool depthPrepass = false;
+    ClusterCulling clusterCulling = ClusterCulling::Off;
+    // coarsest level of detail whose projected error stays below this many pixels is drawn
+    float lodPixelError = 1.f;
+    // record uploads into shared batches, off submits and waits for each copy on its own
+    bool uploadBatching = true;
+    // frames the cpu may record ahead of the gpu, 1 to MAX_FRAMES_IN_FLIGHT
+    uint32_t framesInFlight = 2;
+    // record the scene draws into secondary command buffers on the worker threads
+    bool parallelRecording = false;
+    // replay command buffers recorded once, until the scene, pipelines or swapchain change
+    bool cacheCommands = false;
+    // scene shader variants: plain shading instead of the texture, and cut-outs below half alpha
+    bool textured = true;
+    bool alphaTest = false;
+    // ignore the pipeline cache on disk to time a cold start, it is still written back
+    bool coldPipelineCache = false;
+    // log every pass, barrier and memory slot of the compiled render graph
+    bool dumpRenderGraph = false;
+    // times recording of synthetic draw lists against the thread count, then exits
+    bool benchRecording = false;
+    MeshProcessOptions meshProcessing;
+};
+
+AppOptions parseOptions(int argc, char** argv);
\ No newline at end of file
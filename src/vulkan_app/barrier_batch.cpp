@@ -0,0 +1,71 @@
+#include "barrier_batch.hpp"
+
+void BarrierBatch::init(PFN_vkCmdPipelineBarrier2KHR cmdPipelineBarrier2)
+{
+    this->cmdPipelineBarrier2 = cmdPipelineBarrier2;
+}
+
+void BarrierBatch::memory(VkPipelineStageFlags2 srcStages, VkAccessFlags2 srcAccess, VkPipelineStageFlags2 dstStages, VkAccessFlags2 dstAccess)
+{
+    VkMemoryBarrier2 barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2;
+    barrier.srcStageMask = srcStages;
+    barrier.srcAccessMask = srcAccess;
+    barrier.dstStageMask = dstStages;
+    barrier.dstAccessMask = dstAccess;
+    memoryBarriers.push_back(barrier);
+}
+
+void BarrierBatch::buffer(const VkBufferMemoryBarrier2& barrier)
+{
+    bufferBarriers.push_back(barrier);
+}
+
+void BarrierBatch::image(const VkImageMemoryBarrier2& barrier)
+{
+    imageBarriers.push_back(barrier);
+}
+
+void BarrierBatch::image(VkImage image, uint32_t baseMipLevel, uint32_t levelCount, VkImageLayout oldLayout, VkImageLayout newLayout,
+    VkPipelineStageFlags2 srcStages, VkAccessFlags2 srcAccess, VkPipelineStageFlags2 dstStages, VkAccessFlags2 dstAccess)
+{
+    VkImageMemoryBarrier2 barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2;
+    barrier.srcStageMask = srcStages;
+    barrier.srcAccessMask = srcAccess;
+    barrier.dstStageMask = dstStages;
+    barrier.dstAccessMask = dstAccess;
+    barrier.oldLayout = oldLayout;
+    barrier.newLayout = newLayout;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = image;
+    barrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, baseMipLevel, levelCount, 0, 1};
+    imageBarriers.push_back(barrier);
+}
+
+void BarrierBatch::flush(VkCommandBuffer commandBuffer)
+{
+    if (empty())
+    {
+        return;
+    }
+
+    VkDependencyInfo dependencyInfo{};
+    dependencyInfo.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+    dependencyInfo.memoryBarrierCount = static_cast<uint32_t>(memoryBarriers.size());
+    dependencyInfo.pMemoryBarriers = memoryBarriers.data();
+    dependencyInfo.bufferMemoryBarrierCount = static_cast<uint32_t>(bufferBarriers.size());
+    dependencyInfo.pBufferMemoryBarriers = bufferBarriers.data();
+    dependencyInfo.imageMemoryBarrierCount = static_cast<uint32_t>(imageBarriers.size());
+    dependencyInfo.pImageMemoryBarriers = imageBarriers.data();
+
+    cmdPipelineBarrier2(commandBuffer, &dependencyInfo);
+
+    barrierCount += static_cast<uint32_t>(memoryBarriers.size() + bufferBarriers.size() + imageBarriers.size());
+    ++flushCount;
+
+    memoryBarriers.clear();
+    bufferBarriers.clear();
+    imageBarriers.clear();
+}
\ No newline at end of file
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <vector>
+#include <cstdint>
+
+// collects memory, buffer and image barriers and records them with a single vkCmdPipelineBarrier2KHR,
+// each barrier keeps its own stage and access masks
+class BarrierBatch
+{
+public:
+    void init(PFN_vkCmdPipelineBarrier2KHR cmdPipelineBarrier2);
+
+    void memory(VkPipelineStageFlags2 srcStages, VkAccessFlags2 srcAccess, VkPipelineStageFlags2 dstStages, VkAccessFlags2 dstAccess);
+    void buffer(const VkBufferMemoryBarrier2& barrier);
+    void image(const VkImageMemoryBarrier2& barrier);
+    // color mip levels of an image changing layout on one queue
+    void image(VkImage image, uint32_t baseMipLevel, uint32_t levelCount, VkImageLayout oldLayout, VkImageLayout newLayout,
+        VkPipelineStageFlags2 srcStages, VkAccessFlags2 srcAccess, VkPipelineStageFlags2 dstStages, VkAccessFlags2 dstAccess);
+
+    bool empty() const { return memoryBarriers.empty() && bufferBarriers.empty() && imageBarriers.empty(); }
+    // records everything collected so far, nothing without barriers
+    void flush(VkCommandBuffer commandBuffer);
+
+    uint32_t getBarrierCount() const { return barrierCount; }
+    uint32_t getFlushCount() const { return flushCount; }
+
+private:
+    PFN_vkCmdPipelineBarrier2KHR cmdPipelineBarrier2 = nullptr;
+
+    std::vector<VkMemoryBarrier2> memoryBarriers;
+    std::vector<VkBufferMemoryBarrier2> bufferBarriers;
+    std::vector<VkImageMemoryBarrier2> imageBarriers;
+
+    uint32_t barrierCount = 0;
+    uint32_t flushCount = 0;
+};
\ No newline at end of file
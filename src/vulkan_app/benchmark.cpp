@@ -0,0 +1,89 @@
+#include "benchmark.hpp"
+#include "load_model.hpp"
+
+#include <chrono>
+
+static const uint32_t BENCHMARK_REPEATS = 5;
+
+static bool sameMeshes(const std::vector<Mesh>& a, const std::vector<Mesh>& b)
+{
+    if (a.size() != b.size())
+    {
+        return false;
+    }
+
+    for (size_t i = 0; i < a.size(); ++i)
+    {
+        if (a[i].vertices.size() != b[i].vertices.size() || a[i].indices.size() != b[i].indices.size() ||
+            memcmp(&a[i].m_transform, &b[i].m_transform, sizeof(glm::mat4)) != 0 ||
+            memcmp(a[i].vertices.data(), b[i].vertices.data(), a[i].vertices.size() * sizeof(Vertex)) != 0 ||
+            memcmp(a[i].indices.data(), b[i].indices.data(), a[i].indices.size() * sizeof(uint32_t)) != 0)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// best of BENCHMARK_REPEATS, in milliseconds
+static float timeProcessScene(const aiScene *scene, ThreadPool* pool, Model& result)
+{
+    float best = std::numeric_limits<float>::max();
+
+    for (uint32_t run = 0; run < BENCHMARK_REPEATS; ++run)
+    {
+        auto start = std::chrono::high_resolution_clock::now();
+        result.processScene(scene, pool);
+        auto end = std::chrono::high_resolution_clock::now();
+
+        best = std::min(best, std::chrono::duration<float, std::chrono::milliseconds::period>(end - start).count());
+    }
+
+    return best;
+}
+
+void runImportBenchmark(const std::string& path)
+{
+    Assimp::Importer importer;
+
+    auto parseStart = std::chrono::high_resolution_clock::now();
+    const aiScene *scene = importer.ReadFile(path, MODEL_IMPORT_FLAGS);
+    auto parseEnd = std::chrono::high_resolution_clock::now();
+
+    if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode)
+    {
+        throw std::runtime_error(std::string("ERROR::ASSIMP::") + std::string(importer.GetErrorString()));
+    }
+
+    size_t vertexCount = 0;
+    size_t faceCount = 0;
+    for (uint32_t i = 0; i < scene->mNumMeshes; ++i)
+    {
+        vertexCount += scene->mMeshes[i]->mNumVertices;
+        faceCount += scene->mMeshes[i]->mNumFaces;
+    }
+
+    SDL_Log("import benchmark: %s, %u meshes, %zu vertices, %zu faces", path.c_str(), scene->mNumMeshes, vertexCount, faceCount);
+    SDL_Log("  parse: %.2f ms", std::chrono::duration<float, std::chrono::milliseconds::period>(parseEnd - parseStart).count());
+
+    Model reference;
+    float serialTime = timeProcessScene(scene, nullptr, reference);
+    SDL_Log("  serial: %.2f ms", serialTime);
+
+    uint32_t maxThreads = std::max(1u, std::thread::hardware_concurrency());
+    for (uint32_t threads = 1; ; threads = std::min(threads * 2, maxThreads))
+    {
+        ThreadPool pool(threads);
+        Model model;
+        float time = timeProcessScene(scene, &pool, model);
+
+        SDL_Log("  %2u threads: %.2f ms, speedup x%.2f, %s", threads, time, serialTime / time,
+            sameMeshes(reference.meshes, model.meshes) ? "identical" : "MISMATCH");
+
+        if (threads == maxThreads)
+        {
+            break;
+        }
+    }
+}
\ No newline at end of file
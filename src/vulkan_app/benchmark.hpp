@@ -0,0 +1,7 @@
+#pragma once
+
+#include <string>
+
+// imports the model once and converts it with 1, 2, 4 ... N threads,
+// checking that every run matches the serial result
+void runImportBenchmark(const std::string& path);
\ No newline at end of file
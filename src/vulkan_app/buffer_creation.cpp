@@ -1,22 +1,6 @@
 #include "vulkan_app.hpp"
 
-uint32_t VulkanApp::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties)
-{
-    VkPhysicalDeviceMemoryProperties memProperties;
-    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
-
-    for (uint32_t i = 0; i < memProperties.memoryTypeCount; ++i)
-    {
-        if ((typeFilter & (1 << i)) && (memProperties.memoryTypes[i].propertyFlags & properties) == properties)
-        {
-            return i;
-        }
-    }
-
-    throw std::runtime_error("failed to find suitable memory type!");
-}
-
-void VulkanApp::createBuffer(CustomBufferCreateInfo& customBufferInfo, VkBuffer& buffer, VkDeviceMemory& bufferMemory)
+void VulkanApp::createBuffer(CustomBufferCreateInfo& customBufferInfo, VkBuffer& buffer, MemoryAllocation& bufferMemory)
 {
     VkBufferCreateInfo bufferInfo{};
     bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
@@ -34,106 +18,125 @@ void VulkanApp::createBuffer(CustomBufferCreateInfo& customBufferInfo, VkBuffer&
     VkMemoryRequirements memRequirements;
     vkGetBufferMemoryRequirements(device, buffer, &memRequirements);
 
-    VkMemoryAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    allocInfo.allocationSize = memRequirements.size;
-    allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, customBufferInfo.properties);
-
-    if (vkAllocateMemory(device, &allocInfo, nullptr, &bufferMemory) != VK_SUCCESS)
-    {
-        throw std::runtime_error("failed to allocate buffer memory!");
-    }     
+    bufferMemory = memoryAllocator.allocate(memRequirements, customBufferInfo.properties, ResourceKind::Linear);
 
-    vkBindBufferMemory(device, buffer, bufferMemory, 0);   
+    vkBindBufferMemory(device, buffer, bufferMemory.memory, bufferMemory.offset);
 }   
 
-void VulkanApp::copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size)
+void VulkanApp::copyBuffer(VkBuffer srcBuffer, VkDeviceSize srcOffset, VkBuffer dstBuffer, VkDeviceSize size)
 {
-    VkCommandBuffer commandBuffer = beginSingleTimeCommands(transferCommandPool);
-
     VkBufferCopy copyRegion{};
-    copyRegion.srcOffset = 0;
+    copyRegion.srcOffset = srcOffset;
     copyRegion.dstOffset = 0;
     copyRegion.size = size;
-    vkCmdCopyBuffer(commandBuffer, srcBuffer, dstBuffer, 1, &copyRegion);
+    vkCmdCopyBuffer(transferUploads.commandBuffer(), srcBuffer, dstBuffer, 1, &copyRegion);
+    releaseBuffer(dstBuffer);
 
-    endSingleTimeCommands(transferCommandPool, commandBuffer, transferQueue);
+    transferUploads.endOperation();
 }
 
-void VulkanApp::createVertexBuffer()
+void VulkanApp::createDeviceLocalBuffer(const void* data, VkDeviceSize size, VkBufferUsageFlags usage, VkBuffer& buffer, MemoryAllocation& bufferMemory)
 {
-    QueueFamilyIndices familyIndices = findQueueFamilies(physicalDevice);
-    uint32_t queueFamilyIndices[] = {familyIndices.graphicsFamily.value(), familyIndices.transferFamily.value()};
-
-    VkBuffer stagingBuffer;
-    VkDeviceMemory stagingBufferMemory;
+    StagingAllocation staging = transferUploads.stage(size);
+    memcpy(staging.mapped, data, (size_t) size);
 
     CustomBufferCreateInfo customBufferInfo{};
-    customBufferInfo.size = sizeof(vertices[0]) * vertices.size();
-    customBufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
-    customBufferInfo.properties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
-    customBufferInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
-    customBufferInfo.queueFamilyIndexCount = 2;
-    customBufferInfo.pQueueFamilyIndices = queueFamilyIndices;
-
-    createBuffer(customBufferInfo, stagingBuffer, stagingBufferMemory);
-
-    void* data;
-    vkMapMemory(device, stagingBufferMemory, 0, customBufferInfo.size, 0, &data);
-    memcpy(data, vertices.data(), (size_t) customBufferInfo.size);
-    vkUnmapMemory(device, stagingBufferMemory);
-
-    customBufferInfo = {};
-    customBufferInfo.size = sizeof(vertices[0]) * vertices.size();
-    customBufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
+    customBufferInfo.size = size;
+    customBufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT | usage;
     customBufferInfo.properties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
-    customBufferInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
-    customBufferInfo.queueFamilyIndexCount = 2;
-    customBufferInfo.pQueueFamilyIndices = queueFamilyIndices;
+    customBufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 
-    createBuffer(customBufferInfo, vertexBuffer, vertexBufferMemory);
+    createBuffer(customBufferInfo, buffer, bufferMemory);
 
-    copyBuffer(stagingBuffer, vertexBuffer, customBufferInfo.size);
+    copyBuffer(staging.buffer, staging.offset, buffer, size);
+}
 
-    vkDestroyBuffer(device, stagingBuffer, nullptr);
-    vkFreeMemory(device, stagingBufferMemory, nullptr);
-}   
+void VulkanApp::createVertexBuffer()
+{
+    VkDeviceSize bufferSize = static_cast<VkDeviceSize>(vertexStride(geometryView.vertexFormat)) * geometryView.vertexCount;
+    createDeviceLocalBuffer(geometryView.vertices, bufferSize, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, vertexBuffer, vertexBufferMemory);
+
+    // depth-only passes fetch nothing but positions, give them a stream without the other attributes
+    if (options.depthPrepass)
+    {
+        std::vector<uint8_t> positions;
+        extractPositions(geometryView.vertexFormat, geometryView.vertices, geometryView.vertexCount, positions);
+        createDeviceLocalBuffer(positions.data(), positions.size(), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, positionBuffer, positionBufferMemory);
+    }
+}
 
 void VulkanApp::createIndexBuffer()
 {
-    QueueFamilyIndices familyIndices = findQueueFamilies(physicalDevice);
-    uint32_t queueFamilyIndices[] = {familyIndices.graphicsFamily.value(), familyIndices.transferFamily.value()};
+    auto firstMesh32 = std::partition_point(meshRanges.begin(), meshRanges.end(), [](const MeshRange& range)
+    {
+        return range.indexType == VK_INDEX_TYPE_UINT16;
+    });
+    meshCount16 = static_cast<uint32_t>(firstMesh32 - meshRanges.begin());
+
+    // one buffer per index type, a model made only of small or only of large meshes needs just one
+    if (geometryView.index16Count > 0)
+    {
+        createDeviceLocalBuffer(geometryView.indices16, sizeof(uint16_t) * geometryView.index16Count, VK_BUFFER_USAGE_INDEX_BUFFER_BIT, indexBuffer16, indexBuffer16Memory);
+    }
+    if (geometryView.index32Count > 0)
+    {
+        createDeviceLocalBuffer(geometryView.indices32, sizeof(uint32_t) * geometryView.index32Count, VK_BUFFER_USAGE_INDEX_BUFFER_BIT, indexBuffer32, indexBuffer32Memory);
+    }
+}
+
+void VulkanApp::createIndirectBuffer()
+{
+    // a single mesh is drawn directly, multi-draw only pays off from two ranges on
+    if (!multiDrawIndirectSupported || meshRanges.size() < 2)
+    {
+        return;
+    }
 
-    VkBuffer stagingBuffer;
-    VkDeviceMemory stagingBufferMemory;
+    VkPhysicalDeviceProperties deviceProperties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+    if (meshRanges.size() > deviceProperties.limits.maxDrawIndirectCount)
+    {
+        return;
+    }
 
-    CustomBufferCreateInfo customBufferInfo{};
-    customBufferInfo.size = sizeof(indices[0]) * indices.size();
-    customBufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
-    customBufferInfo.properties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
-    customBufferInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
-    customBufferInfo.queueFamilyIndexCount = 2;
-    customBufferInfo.pQueueFamilyIndices = queueFamilyIndices;
-
-    createBuffer(customBufferInfo, stagingBuffer, stagingBufferMemory);
-
-    void* data;
-    vkMapMemory(device, stagingBufferMemory, 0, customBufferInfo.size, 0, &data);
-    memcpy(data, indices.data(), (size_t) customBufferInfo.size);
-    vkUnmapMemory(device, stagingBufferMemory);
-
-    customBufferInfo = {};
-    customBufferInfo.size = sizeof(indices[0]) * indices.size();
-    customBufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT;
-    customBufferInfo.properties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
-    customBufferInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
-    customBufferInfo.queueFamilyIndexCount = 2;
-    customBufferInfo.pQueueFamilyIndices = queueFamilyIndices;
+    std::vector<VkDrawIndexedIndirectCommand> drawCommands(meshRanges.size());
+    for (size_t i = 0; i < meshRanges.size(); ++i)
+    {
+        drawCommands[i].indexCount = meshRanges[i].indexCount;
+        drawCommands[i].instanceCount = 1;
+        drawCommands[i].firstIndex = meshRanges[i].firstIndex;
+        drawCommands[i].vertexOffset = static_cast<int32_t>(meshRanges[i].firstVertex);
+        drawCommands[i].firstInstance = static_cast<uint32_t>(i);
+    }
+
+    createDeviceLocalBuffer(drawCommands.data(), sizeof(VkDrawIndexedIndirectCommand) * drawCommands.size(), VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, indirectBuffer, indirectBufferMemory);
+}
 
-    createBuffer(customBufferInfo, indexBuffer, indexBufferMemory);
+void VulkanApp::createMeshDataBuffer()
+{
+    std::vector<MeshShaderData> meshData(meshRanges.size());
+    for (size_t i = 0; i < meshRanges.size(); ++i)
+    {
+        if (geometryView.vertexFormat == VertexFormat::Compact)
+        {
+            // unorm positions span the bounds of their mesh
+            meshData[i].positionOffset = meshRanges[i].boundsMin;
+            meshData[i].positionScale = meshRanges[i].boundsMax - meshRanges[i].boundsMin;
+        }
+        else
+        {
+            meshData[i].positionOffset = glm::vec4(0.f);
+            meshData[i].positionScale = glm::vec4(1.f);
+        }
+    }
 
-    copyBuffer(stagingBuffer, indexBuffer, customBufferInfo.size);
+    createDeviceLocalBuffer(meshData.data(), sizeof(MeshShaderData) * meshData.size(), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, meshDataBuffer, meshDataBufferMemory);
+}
 
-    vkDestroyBuffer(device, stagingBuffer, nullptr);
-    vkFreeMemory(device, stagingBufferMemory, nullptr);
-} 
\ No newline at end of file
+void VulkanApp::logMemoryStats(const char* when)
+{
+    MemoryStats stats = memoryAllocator.getStats();
+    SDL_Log("device memory %s: %u allocations in %u blocks (%.1f MiB) and %u dedicated, %.1f MiB used, %.1f MiB peak, %.1f%% of free block space fragmented",
+        when, stats.allocationCount, stats.blockCount, stats.blockBytes / 1048576.0, stats.dedicatedCount,
+        stats.usedBytes / 1048576.0, stats.peakUsedBytes / 1048576.0, 100.f * stats.fragmentation);
+}
\ No newline at end of file
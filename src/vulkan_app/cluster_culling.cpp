@@ -0,0 +1,390 @@
+#include "vulkan_app.hpp"
+
+void VulkanApp::createClusterCulling()
+{
+    clusterCulling = options.clusterCulling;
+    if (clusterCulling == ClusterCulling::Off)
+    {
+        return;
+    }
+
+    if (geometryView.meshletCount == 0)
+    {
+        SDL_Log("model has no meshlets, cluster culling disabled");
+        clusterCulling = ClusterCulling::Off;
+        return;
+    }
+
+    // meshlets are culled against one frustum in the space of the model, which holds only while the meshes sit untransformed in it
+    for (const auto& range : meshRanges)
+    {
+        if (range.transform != glm::mat4(1.f))
+        {
+            SDL_Log("model has transformed meshes, cluster culling disabled");
+            clusterCulling = ClusterCulling::Off;
+            return;
+        }
+    }
+
+    meshletCount16 = geometryView.meshletCount;
+    for (const auto& range : meshRanges)
+    {
+        if (range.indexType != VK_INDEX_TYPE_UINT16)
+        {
+            meshletCount16 = range.firstMeshlet;
+            break;
+        }
+    }
+
+    if (clusterCulling == ClusterCulling::Gpu)
+    {
+        VkPhysicalDeviceProperties deviceProperties;
+        vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+
+        QueueFamilyIndices indices = findQueueFamilies(physicalDevice);
+        uint32_t queueFamilyCount = 0;
+        vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+        std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+        vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilies.data());
+
+        // the gpu writes one draw per meshlet, culled ones with no instances, and draws them all at once
+        bool computeSupported = queueFamilies[indices.graphicsFamily.value()].queueFlags & VK_QUEUE_COMPUTE_BIT;
+        if (!computeSupported || !multiDrawIndirectSupported || geometryView.meshletCount > deviceProperties.limits.maxDrawIndirectCount)
+        {
+            SDL_Log("gpu cluster culling is not supported, culling on the cpu");
+            clusterCulling = ClusterCulling::Cpu;
+        }
+    }
+
+    VkDeviceSize drawBufferSize = sizeof(VkDrawIndexedIndirectCommand) * geometryView.meshletCount;
+
+    clusterDrawBuffers.resize(framesInFlight);
+    clusterDrawBuffersMemory.resize(framesInFlight);
+    clusterDrawBuffersMapped.assign(framesInFlight, nullptr);
+    clusterDrawCounts.assign(framesInFlight, {0, 0});
+
+    CustomBufferCreateInfo customBufferInfo{};
+    customBufferInfo.size = drawBufferSize;
+    customBufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    if (clusterCulling == ClusterCulling::Cpu)
+    {
+        // written by the cpu every frame, read once by the gpu
+        customBufferInfo.usage = VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT;
+        customBufferInfo.properties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+
+        for (size_t i = 0; i < framesInFlight; ++i)
+        {
+            createBuffer(customBufferInfo, clusterDrawBuffers[i], clusterDrawBuffersMemory[i]);
+            clusterDrawBuffersMapped[i] = clusterDrawBuffersMemory[i].mapped;
+        }
+
+        SDL_Log("culling %u clusters on the cpu", geometryView.meshletCount);
+        return;
+    }
+
+    customBufferInfo.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT;
+    customBufferInfo.properties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+
+    for (size_t i = 0; i < framesInFlight; ++i)
+    {
+        createBuffer(customBufferInfo, clusterDrawBuffers[i], clusterDrawBuffersMemory[i]);
+    }
+
+    cullStatsBuffers.resize(framesInFlight);
+    cullStatsBuffersMemory.resize(framesInFlight);
+    cullStatsBuffersMapped.resize(framesInFlight);
+    cullStatsWritten.assign(framesInFlight, false);
+
+    // visible clusters and their triangles
+    customBufferInfo = {};
+    customBufferInfo.size = sizeof(uint32_t) * 2;
+    customBufferInfo.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+    customBufferInfo.properties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+    customBufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    for (size_t i = 0; i < framesInFlight; ++i)
+    {
+        createBuffer(customBufferInfo, cullStatsBuffers[i], cullStatsBuffersMemory[i]);
+        cullStatsBuffersMapped[i] = cullStatsBuffersMemory[i].mapped;
+        memset(cullStatsBuffersMapped[i], 0, customBufferInfo.size);
+    }
+
+    createDeviceLocalBuffer(geometryView.meshlets, sizeof(Meshlet) * geometryView.meshletCount, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, meshletBuffer, meshletBufferMemory);
+
+    createCullPipeline();
+
+    SDL_Log("culling %u clusters on the gpu", geometryView.meshletCount);
+}
+
+void VulkanApp::createCullPipeline()
+{
+    std::array<VkDescriptorSetLayoutBinding, 3> bindings{};
+    for (uint32_t i = 0; i < bindings.size(); ++i)
+    {
+        // meshlets, draw commands, visible counts
+        bindings[i].binding = i;
+        bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        bindings[i].descriptorCount = 1;
+        bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+        bindings[i].pImmutableSamplers = nullptr;
+    }
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+    layoutInfo.pBindings = bindings.data();
+
+    if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &cullDescriptorSetLayout) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create cull descriptor set layout!");
+    }
+
+    VkDescriptorPoolSize poolSize{};
+    poolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    poolSize.descriptorCount = static_cast<uint32_t>(bindings.size() * framesInFlight);
+
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.poolSizeCount = 1;
+    poolInfo.pPoolSizes = &poolSize;
+    poolInfo.maxSets = framesInFlight;
+
+    if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &cullDescriptorPool) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create cull descriptor pool!");
+    }
+
+    std::vector<VkDescriptorSetLayout> layouts(framesInFlight, cullDescriptorSetLayout);
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = cullDescriptorPool;
+    allocInfo.descriptorSetCount = framesInFlight;
+    allocInfo.pSetLayouts = layouts.data();
+
+    cullDescriptorSets.resize(framesInFlight);
+    if (vkAllocateDescriptorSets(device, &allocInfo, cullDescriptorSets.data()) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to allocate cull descriptor sets!");
+    }
+
+    for (size_t i = 0; i < framesInFlight; ++i)
+    {
+        std::array<VkDescriptorBufferInfo, 3> bufferInfos{};
+        bufferInfos[0].buffer = meshletBuffer;
+        bufferInfos[0].range = VK_WHOLE_SIZE;
+        bufferInfos[1].buffer = clusterDrawBuffers[i];
+        bufferInfos[1].range = VK_WHOLE_SIZE;
+        bufferInfos[2].buffer = cullStatsBuffers[i];
+        bufferInfos[2].range = VK_WHOLE_SIZE;
+
+        std::array<VkWriteDescriptorSet, 3> descriptorWrites{};
+        for (uint32_t j = 0; j < descriptorWrites.size(); ++j)
+        {
+            descriptorWrites[j].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            descriptorWrites[j].dstSet = cullDescriptorSets[i];
+            descriptorWrites[j].dstBinding = j;
+            descriptorWrites[j].dstArrayElement = 0;
+            descriptorWrites[j].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            descriptorWrites[j].descriptorCount = 1;
+            descriptorWrites[j].pBufferInfo = &bufferInfos[j];
+        }
+
+        vkUpdateDescriptorSets(device, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+    }
+
+    VkPushConstantRange pushConstantRange{};
+    pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    pushConstantRange.offset = 0;
+    pushConstantRange.size = sizeof(CullConstants);
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &cullDescriptorSetLayout;
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+    if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &cullPipelineLayout) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create cull pipeline layout!");
+    }
+
+    auto cullShaderCode = readBinaryFile("resources/shaders/cull.comp.spv");
+    VkShaderModule cullShaderModule = createShaderModule(cullShaderCode);
+
+    VkComputePipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    pipelineInfo.stage.module = cullShaderModule;
+    pipelineInfo.stage.pName = "main";
+    pipelineInfo.layout = cullPipelineLayout;
+
+    if (pipelineCache.createComputePipeline(pipelineInfo, cullPipeline) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create cull pipeline!");
+    }
+
+    vkDestroyShaderModule(device, cullShaderModule, nullptr);
+}
+
+void VulkanApp::cullClustersCpu(uint32_t frame)
+{
+    if (clusterCulling != ClusterCulling::Cpu)
+    {
+        return;
+    }
+
+    CullFrustum frustum = makeCullFrustum(frameTransforms.proj, frameTransforms.view, frameTransforms.model);
+    auto draws = static_cast<VkDrawIndexedIndirectCommand*>(clusterDrawBuffersMapped[frame]);
+
+    // visible draws are compacted, 16-bit ones first
+    uint32_t drawCount = 0;
+    uint64_t triangles = 0;
+    auto cullRange = [&](uint32_t first, uint32_t last)
+    {
+        uint32_t firstDraw = drawCount;
+        for (uint32_t i = first; i < last; ++i)
+        {
+            const Meshlet& meshlet = geometryView.meshlets[i];
+            if (!isMeshletVisible(meshlet, frustum))
+            {
+                continue;
+            }
+
+            triangles += meshlet.triangleCount;
+            VkDrawIndexedIndirectCommand& draw = draws[drawCount++];
+            draw.indexCount = meshlet.triangleCount * 3;
+            draw.instanceCount = 1;
+            draw.firstIndex = meshlet.firstIndex;
+            draw.vertexOffset = static_cast<int32_t>(meshlet.vertexOffset);
+            draw.firstInstance = meshlet.mesh;
+        }
+        return drawCount - firstDraw;
+    };
+
+    clusterDrawCounts[frame][0] = cullRange(0, meshletCount16);
+    clusterDrawCounts[frame][1] = cullRange(meshletCount16, geometryView.meshletCount);
+
+    addCullStats(geometryView.meshletCount, drawCount);
+    addSubmittedTriangles(triangles);
+}
+
+void VulkanApp::recordClusterCulling(VkCommandBuffer commandBuffer)
+{
+    if (clusterCulling != ClusterCulling::Gpu)
+    {
+        return;
+    }
+
+    CullConstants constants{};
+    constants.frustum = makeCullFrustum(frameTransforms.proj, frameTransforms.view, frameTransforms.model);
+    constants.meshletCount = geometryView.meshletCount;
+
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, cullPipeline);
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, cullPipelineLayout, 0, 1, &cullDescriptorSets[currentFrame], 0, nullptr);
+    vkCmdPushConstants(commandBuffer, cullPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(constants), &constants);
+    // matches local_size_x of cull.comp
+    vkCmdDispatch(commandBuffer, (geometryView.meshletCount + 63) / 64, 1, 1);
+
+    // the render graph makes the draws visible to the indirect draws and the counts to the host
+    cullStatsWritten[currentFrame] = true;
+}
+
+void VulkanApp::recordClusterDraws(VkCommandBuffer commandBuffer)
+{
+    VkBuffer drawBuffer = clusterDrawBuffers[currentFrame];
+
+    if (clusterCulling == ClusterCulling::Cpu)
+    {
+        const auto& counts = clusterDrawCounts[currentFrame];
+        recordIndirectDraws(commandBuffer, VK_INDEX_TYPE_UINT16, drawBuffer, 0, counts[0]);
+        recordIndirectDraws(commandBuffer, VK_INDEX_TYPE_UINT32, drawBuffer, counts[0], counts[1]);
+    }
+    else
+    {
+        // one draw per meshlet, culled ones have no instances
+        recordIndirectDraws(commandBuffer, VK_INDEX_TYPE_UINT16, drawBuffer, 0, meshletCount16);
+        recordIndirectDraws(commandBuffer, VK_INDEX_TYPE_UINT32, drawBuffer, meshletCount16, geometryView.meshletCount - meshletCount16);
+    }
+}
+
+void VulkanApp::recordIndirectDraws(VkCommandBuffer commandBuffer, VkIndexType indexType, VkBuffer drawBuffer, uint32_t firstDraw, uint32_t drawCount)
+{
+    if (drawCount == 0)
+    {
+        return;
+    }
+
+    VkBuffer indexBuffer = indexType == VK_INDEX_TYPE_UINT16 ? indexBuffer16 : indexBuffer32;
+    vkCmdBindIndexBuffer(commandBuffer, indexBuffer, 0, indexType);
+
+    VkDeviceSize stride = sizeof(VkDrawIndexedIndirectCommand);
+    if (multiDrawIndirectSupported)
+    {
+        vkCmdDrawIndexedIndirect(commandBuffer, drawBuffer, firstDraw * stride, drawCount, static_cast<uint32_t>(stride));
+        return;
+    }
+
+    for (uint32_t i = firstDraw; i < firstDraw + drawCount; ++i)
+    {
+        vkCmdDrawIndexedIndirect(commandBuffer, drawBuffer, i * stride, 1, static_cast<uint32_t>(stride));
+    }
+}
+
+void VulkanApp::readCullStats(uint32_t frame)
+{
+    if (clusterCulling != ClusterCulling::Gpu || !cullStatsWritten[frame])
+    {
+        return;
+    }
+
+    // the frame has retired on the timeline, the counts are final; reset them for the next use of this frame
+    auto stats = static_cast<uint32_t*>(cullStatsBuffersMapped[frame]);
+    addCullStats(geometryView.meshletCount, stats[0]);
+    addSubmittedTriangles(stats[1]);
+    stats[0] = 0;
+    stats[1] = 0;
+    cullStatsWritten[frame] = false;
+}
+
+void VulkanApp::addCullStats(uint32_t tested, uint32_t visible)
+{
+    clustersTested += tested;
+    clustersCulled += tested - visible;
+
+    float time = getTime();
+    if (time - lastCullReport >= 1.f && clustersTested > 0)
+    {
+        SDL_Log("cluster culling (%s): %.1f%% of clusters culled (%llu of %llu tested)",
+            clusterCulling == ClusterCulling::Gpu ? "gpu" : "cpu", 100.0 * clustersCulled / clustersTested,
+            static_cast<unsigned long long>(clustersCulled), static_cast<unsigned long long>(clustersTested));
+        clustersTested = 0;
+        clustersCulled = 0;
+        lastCullReport = time;
+    }
+}
+
+void VulkanApp::cleanupClusterCulling()
+{
+    for (size_t i = 0; i < clusterDrawBuffers.size(); ++i)
+    {
+        vkDestroyBuffer(device, clusterDrawBuffers[i], nullptr);
+        memoryAllocator.free(clusterDrawBuffersMemory[i]);
+    }
+
+    for (size_t i = 0; i < cullStatsBuffers.size(); ++i)
+    {
+        vkDestroyBuffer(device, cullStatsBuffers[i], nullptr);
+        memoryAllocator.free(cullStatsBuffersMemory[i]);
+    }
+
+    vkDestroyBuffer(device, meshletBuffer, nullptr);
+    memoryAllocator.free(meshletBufferMemory);
+
+    vkDestroyPipeline(device, cullPipeline, nullptr);
+    vkDestroyPipelineLayout(device, cullPipelineLayout, nullptr);
+    vkDestroyDescriptorPool(device, cullDescriptorPool, nullptr);
+    vkDestroyDescriptorSetLayout(device, cullDescriptorSetLayout, nullptr);
+}
\ No newline at end of file
@@ -13,21 +13,11 @@ void VulkanApp::createCommandPools()
     {
         throw std::runtime_error("failed to create graphics command pool!");
     }
-
-    poolInfo = {};
-    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
-    poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
-    poolInfo.queueFamilyIndex = queueFamilyIndices.transferFamily.value();
-
-    if (vkCreateCommandPool(device, &poolInfo, nullptr, &transferCommandPool) != VK_SUCCESS)
-    {
-        throw std::runtime_error("failed to create transfer command pool!");
-    }
 }
 
 void VulkanApp::createCommandBuffers()
 {
-    graphicsCommandBuffers.resize(MAX_FRAMES_IN_FLIGHT);
+    graphicsCommandBuffers.resize(framesInFlight);
 
     VkCommandBufferAllocateInfo allocInfo{};
     allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
@@ -39,6 +29,76 @@ void VulkanApp::createCommandBuffers()
     {
         throw std::runtime_error("failed to allocate graphics command buffers!");
     }
+
+    if (!options.cacheCommands)
+    {
+        return;
+    }
+
+    // culling on the cpu and per-draw levels of detail bake per-frame data into the draws
+    if (clusterCulling != ClusterCulling::Off || (indirectBuffer == VK_NULL_HANDLE && lodSelection))
+    {
+        SDL_Log("command buffers are recorded every frame, the draws change with the camera");
+        return;
+    }
+
+    commandCaching = true;
+    SDL_Log("command buffers are recorded once per frame slot and swapchain image");
+}
+
+void VulkanApp::invalidateCommandBuffers()
+{
+    ++sceneVersion;
+}
+
+VkCommandBuffer VulkanApp::prepareGraphicsCommandBuffer(uint32_t imageIndex)
+{
+    auto start = std::chrono::high_resolution_clock::now();
+
+    VkCommandBuffer commandBuffer = graphicsCommandBuffers[currentFrame];
+    if (commandCaching)
+    {
+        // one cache per frame slot, so a swapchain that comes back with another image count
+        // never hands a buffer of one slot to another; the extra buffers are kept once allocated
+        cachedCommandBuffers.resize(framesInFlight);
+        cachedCommandVersions.resize(framesInFlight);
+        std::vector<VkCommandBuffer>& slotBuffers = cachedCommandBuffers[currentFrame];
+        std::vector<uint64_t>& slotVersions = cachedCommandVersions[currentFrame];
+
+        size_t cacheSize = swapChainImages.size();
+        if (slotBuffers.size() < cacheSize)
+        {
+            size_t allocated = slotBuffers.size();
+            slotBuffers.resize(cacheSize);
+            slotVersions.resize(cacheSize, 0);
+
+            VkCommandBufferAllocateInfo allocInfo{};
+            allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+            allocInfo.commandPool = graphicsCommandPool;
+            allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+            allocInfo.commandBufferCount = static_cast<uint32_t>(cacheSize - allocated);
+
+            if (vkAllocateCommandBuffers(device, &allocInfo, &slotBuffers[allocated]) != VK_SUCCESS)
+            {
+                throw std::runtime_error("failed to allocate cached command buffers!");
+            }
+        }
+
+        // only this frame slot submits the buffer, and its previous frame has retired
+        commandBuffer = slotBuffers[imageIndex];
+        if (slotVersions[imageIndex] == sceneVersion)
+        {
+            return commandBuffer;
+        }
+        slotVersions[imageIndex] = sceneVersion;
+    }
+
+    vkResetCommandBuffer(commandBuffer, 0);
+    recordGraphicsCommandBuffer(commandBuffer, imageIndex);
+    ++recordedCommandBuffers;
+
+    recordMilliseconds += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    return commandBuffer;
 }
 
 void VulkanApp::recordGraphicsCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex)
@@ -53,6 +113,32 @@ void VulkanApp::recordGraphicsCommandBuffer(VkCommandBuffer commandBuffer, uint3
         throw std::runtime_error("failed to begin recording command bufer!");
     }
 
+    if (timestampQueryPool != VK_NULL_HANDLE)
+    {
+        vkCmdResetQueryPool(commandBuffer, timestampQueryPool, currentFrame * TIMESTAMPS_PER_FRAME, TIMESTAMPS_PER_FRAME);
+    }
+
+    // the passes pick up this frame's handles while they record
+    recordImageIndex = imageIndex;
+    renderGraph.bindImage(swapChainResource, swapChainImages[imageIndex]);
+    if (clusterCulling == ClusterCulling::Gpu)
+    {
+        renderGraph.bindBuffer(clusterDrawResource, clusterDrawBuffers[currentFrame]);
+        renderGraph.bindBuffer(cullStatsResource, cullStatsBuffers[currentFrame]);
+    }
+
+    renderGraph.execute(commandBuffer);
+
+    if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to record command buffer!");
+    }
+}
+
+void VulkanApp::recordScenePass(VkCommandBuffer commandBuffer)
+{
+    uint32_t imageIndex = recordImageIndex;
+
     VkRenderPassBeginInfo renderPassInfo{};
     renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
     renderPassInfo.renderPass = renderPass;  
@@ -67,72 +153,86 @@ void VulkanApp::recordGraphicsCommandBuffer(VkCommandBuffer commandBuffer, uint3
     renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
     renderPassInfo.pClearValues = clearValues.data();
     
-    vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+    // secondaries only pay off once there is something to draw, the clearing frames stay inline
+    // cached primaries may not reference the secondaries, their pools are reset every frame
+    if (!recordCommandPools.empty() && !commandCaching && assetsResident && clusterCulling == ClusterCulling::Off)
+    {
+        // the primary cannot record into a pass that executes secondaries, the timestamps wrap the whole pass
+        writeTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, 0);
+        vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+        recordSceneParallel(commandBuffer, imageIndex);
+        vkCmdEndRenderPass(commandBuffer);
+        writeTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 1);
+        return;
+    }
 
-    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
+    vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
 
-    VkViewport viewport{};
-    viewport.x = 0.0f;
-    viewport.y = 0.0f;
-    viewport.width = static_cast<float>(swapChainExtent.width);
-    viewport.height = static_cast<float>(swapChainExtent.height);
-    viewport.minDepth = 0.0f;
-    viewport.maxDepth = 1.0f;
-    vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+    writeTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, 0);
 
-    VkRect2D scissor{};
-    scissor.offset = {0, 0};
-    scissor.extent = swapChainExtent;
-    vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+    // while the assets stream in the frame only clears
+    if (assetsResident && depthPrepassPipeline && pipelineLibrary.isReady(*depthPrepassPipeline))
+    {
+        bindPassState(commandBuffer, pipelineLibrary.get(*depthPrepassPipeline), positionBuffer);
+        recordMeshDraws(commandBuffer);
+    }
 
-    VkBuffer vertexBuffers[] = {vertexBuffer};
-    VkDeviceSize offsets[] = {0};
-    vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
-    vkCmdBindIndexBuffer(commandBuffer, indexBuffer, 0, VK_INDEX_TYPE_UINT32);
+    if (assetsResident)
+    {
+        bindPassState(commandBuffer, pipelineLibrary.get(scenePipeline), vertexBuffer);
+        recordMeshDraws(commandBuffer);
+    }
 
-    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSets[currentFrame], 0, nullptr);
-    
-    vkCmdDrawIndexed(commandBuffer, static_cast<uint32_t>(indices.size()), 1, 0, 0, 0);
+    writeTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 1);
 
     vkCmdEndRenderPass(commandBuffer);
-
-    if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
-    {
-        throw std::runtime_error("failed to record command buffer!");
-    }
 }
 
-VkCommandBuffer VulkanApp::beginSingleTimeCommands(VkCommandPool commandPool)
+void VulkanApp::pushDrawConstants(VkCommandBuffer commandBuffer, uint32_t objectIndex)
 {
-    VkCommandBufferAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-    allocInfo.commandPool = commandPool;
-    allocInfo.commandBufferCount = 1;
-
-    VkCommandBuffer commandBuffer;
-    vkAllocateCommandBuffers(device, &allocInfo, &commandBuffer);
-
-    VkCommandBufferBeginInfo beginInfo{};
-    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    DrawConstants constants{};
+    constants.objectIndex = objectIndex;
+    vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(constants), &constants);
+}
 
-    vkBeginCommandBuffer(commandBuffer, &beginInfo);
+void VulkanApp::recordMeshDraws(VkCommandBuffer commandBuffer)
+{
+    if (clusterCulling != ClusterCulling::Off)
+    {
+        recordClusterDraws(commandBuffer);
+        return;
+    }
 
-    return commandBuffer;
+    recordMeshDraws(commandBuffer, VK_INDEX_TYPE_UINT16, 0, meshCount16);
+    recordMeshDraws(commandBuffer, VK_INDEX_TYPE_UINT32, meshCount16, static_cast<uint32_t>(meshRanges.size()) - meshCount16);
 }
 
-void VulkanApp::endSingleTimeCommands(VkCommandPool commandPool, VkCommandBuffer commandBuffer, VkQueue queue)
+void VulkanApp::recordMeshDraws(VkCommandBuffer commandBuffer, VkIndexType indexType, uint32_t firstMesh, uint32_t meshCount)
 {
-    vkEndCommandBuffer(commandBuffer);
-
-    VkSubmitInfo submitInfo{};
-    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-    submitInfo.commandBufferCount = 1;
-    submitInfo.pCommandBuffers = &commandBuffer;
+    if (meshCount == 0)
+    {
+        return;
+    }
 
-    vkQueueSubmit(queue, 1, &submitInfo, VK_NULL_HANDLE);
-    vkQueueWaitIdle(queue);
+    VkBuffer indexBuffer = indexType == VK_INDEX_TYPE_UINT16 ? indexBuffer16 : indexBuffer32;
+    vkCmdBindIndexBuffer(commandBuffer, indexBuffer, 0, indexType);
 
-    vkFreeCommandBuffers(device, commandPool, 1, &commandBuffer);
+    if (indirectBuffer != VK_NULL_HANDLE)
+    {
+        // draws with the selected levels of detail are rewritten every frame
+        VkBuffer drawBuffer = lodDrawBuffers.empty() ? indirectBuffer : lodDrawBuffers[currentFrame];
+        VkDeviceSize offset = static_cast<VkDeviceSize>(firstMesh) * sizeof(VkDrawIndexedIndirectCommand);
+        vkCmdDrawIndexedIndirect(commandBuffer, drawBuffer, offset, meshCount, sizeof(VkDrawIndexedIndirectCommand));
+    }
+    else
+    {
+        for (uint32_t i = firstMesh; i < firstMesh + meshCount; ++i)
+        {
+            // the instance index picks the constants of the mesh in the vertex shader, the push its model matrix
+            const MeshRange& range = meshRanges[i];
+            const MeshLod& lod = range.lods[lodSelection ? selectedLods[currentFrame][i] : 0];
+            pushDrawConstants(commandBuffer, i);
+            vkCmdDrawIndexed(commandBuffer, lod.indexCount, 1, lod.firstIndex, static_cast<int32_t>(range.firstVertex), i);
+        }
+    }
 }
\ No newline at end of file
@@ -3,4 +3,11 @@
 #include <string>
 
 const std::string MODEL_PATH = "resources/models/viking_room/viking_room.obj";
-const std::string TEXTURE_PATH = "resources/models/viking_room/viking_room.png";
\ No newline at end of file
+const std::string MODEL_CACHE_PATH = MODEL_PATH + ".meshcache";
+const std::string TEXTURE_PATH = "resources/models/viking_room/viking_room.png";
+// written by texcook, preferred over the source image when present
+const std::string COOKED_TEXTURE_PATH = "resources/models/viking_room/viking_room.ktx2";
+// SPIR-V and the manifest of its variants, written by the shaders target
+const std::string SHADER_DIRECTORY = "resources/shaders/";
+// driver pipeline cache written back on shutdown
+const std::string PIPELINE_CACHE_PATH = SHADER_DIRECTORY + "pipelines.cache";
\ No newline at end of file
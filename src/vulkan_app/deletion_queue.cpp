@@ -0,0 +1,75 @@
+#include "deletion_queue.hpp"
+
+void DeletionQueue::init(VkDevice device, MemoryAllocator* allocator)
+{
+    this->device = device;
+    this->allocator = allocator;
+}
+
+void DeletionQueue::retireBuffer(uint64_t frame, VkBuffer buffer, MemoryAllocation memory)
+{
+    retire(frame, [this, buffer, memory]() mutable
+    {
+        vkDestroyBuffer(device, buffer, nullptr);
+        allocator->free(memory);
+    });
+}
+
+void DeletionQueue::retireImage(uint64_t frame, VkImage image, MemoryAllocation memory)
+{
+    retire(frame, [this, image, memory]() mutable
+    {
+        vkDestroyImage(device, image, nullptr);
+        allocator->free(memory);
+    });
+}
+
+void DeletionQueue::retireImageView(uint64_t frame, VkImageView view)
+{
+    retire(frame, [this, view]()
+    {
+        vkDestroyImageView(device, view, nullptr);
+    });
+}
+
+void DeletionQueue::retireFramebuffer(uint64_t frame, VkFramebuffer framebuffer)
+{
+    retire(frame, [this, framebuffer]()
+    {
+        vkDestroyFramebuffer(device, framebuffer, nullptr);
+    });
+}
+
+void DeletionQueue::retirePipeline(uint64_t frame, VkPipeline pipeline)
+{
+    retire(frame, [this, pipeline]()
+    {
+        vkDestroyPipeline(device, pipeline, nullptr);
+    });
+}
+
+void DeletionQueue::retire(uint64_t frame, std::function<void()> destroy)
+{
+    // keeps the queue sorted, an older frame number only delays the destruction
+    if (!pending.empty() && frame < pending.back().frame)
+    {
+        frame = pending.back().frame;
+    }
+    pending.push_back({frame, std::move(destroy)});
+}
+
+void DeletionQueue::collect(uint64_t retiredFrame)
+{
+    while (!pending.empty() && pending.front().frame <= retiredFrame)
+    {
+        // pop first, the callback may retire more resources
+        std::function<void()> destroy = std::move(pending.front().destroy);
+        pending.pop_front();
+        destroy();
+    }
+}
+
+void DeletionQueue::flush()
+{
+    collect(UINT64_MAX);
+}
\ No newline at end of file
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <deque>
+#include <functional>
+#include <cstdint>
+
+#include "memory_allocator.hpp"
+
+// resources retired with the last frame that used them, destroyed once that frame retired on the gpu
+class DeletionQueue
+{
+public:
+    void init(VkDevice device, MemoryAllocator* allocator);
+
+    void retireBuffer(uint64_t frame, VkBuffer buffer, MemoryAllocation memory);
+    void retireImage(uint64_t frame, VkImage image, MemoryAllocation memory);
+    void retireImageView(uint64_t frame, VkImageView view);
+    void retireFramebuffer(uint64_t frame, VkFramebuffer framebuffer);
+    void retirePipeline(uint64_t frame, VkPipeline pipeline);
+    // anything else, the callback runs once the frame retired
+    void retire(uint64_t frame, std::function<void()> destroy);
+
+    // destroys everything retired up to and including the given frame
+    void collect(uint64_t retiredFrame);
+    // destroys everything, the device has to be idle
+    void flush();
+
+    size_t pendingCount() const { return pending.size(); }
+
+private:
+    struct Retired
+    {
+        uint64_t frame;
+        std::function<void()> destroy;
+    };
+
+    VkDevice device = VK_NULL_HANDLE;
+    MemoryAllocator* allocator = nullptr;
+
+    // frames are retired in order, so the queue stays sorted by frame
+    std::deque<Retired> pending;
+};
\ No newline at end of file
@@ -27,28 +27,4 @@ VkFormat VulkanApp::findDepthFormat()
         VK_IMAGE_TILING_OPTIMAL,
         VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT
     );
-}
-
-void VulkanApp::createDepthResources()
-{
-    VkFormat depthFormat = findDepthFormat();
-
-    CustomImageCreateInfo customImageInfo{};
-    customImageInfo.width = swapChainExtent.width;
-    customImageInfo.height = swapChainExtent.height;
-    customImageInfo.format = depthFormat;
-    customImageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
-    customImageInfo.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
-    customImageInfo.properties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
-    
-    createImage(customImageInfo, depthImage, depthImageMemory);
-
-    CustomImageViewCreateInfo customImageViewInfo{};
-    customImageViewInfo.format = depthFormat;
-    customImageViewInfo.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
-
-    createImageView(customImageViewInfo, depthImage, depthImageView);
-
-    transitionImageLayout(depthImage, depthFormat, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL);
-
 }
\ No newline at end of file
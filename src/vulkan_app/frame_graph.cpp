@@ -0,0 +1,65 @@
+#include "vulkan_app.hpp"
+
+static bool hasStencilComponent(VkFormat format)
+{
+    return format == VK_FORMAT_D32_SFLOAT_S8_UINT || format == VK_FORMAT_D24_UNORM_S8_UINT;
+}
+
+void VulkanApp::createRenderGraph()
+{
+    renderGraph.init(device, &memoryAllocator, cmdPipelineBarrier2);
+
+    swapChainResource = renderGraph.importImage("swapchain", VK_IMAGE_ASPECT_COLOR_BIT, ResourceUsage::Acquired);
+
+    // cleared every frame, so it lives in graph memory that later transients can reuse
+    VkFormat depthFormat = findDepthFormat();
+    TransientImageInfo depthInfo{};
+    depthInfo.format = depthFormat;
+    depthInfo.extent = swapChainExtent;
+    depthInfo.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+    depthInfo.aspect = VK_IMAGE_ASPECT_DEPTH_BIT;
+    if (hasStencilComponent(depthFormat))
+    {
+        depthInfo.aspect |= VK_IMAGE_ASPECT_STENCIL_BIT;
+    }
+    depthResource = renderGraph.createImage("depth", depthInfo);
+
+    if (clusterCulling == ClusterCulling::Gpu)
+    {
+        // the per-frame buffers were last used by a frame that has retired
+        clusterDrawResource = renderGraph.importBuffer("cluster draws", ResourceUsage::None);
+        cullStatsResource = renderGraph.importBuffer("cull stats", ResourceUsage::None);
+
+        renderGraph.addPass("cluster culling", [this](VkCommandBuffer commandBuffer)
+        {
+            if (assetsResident)
+            {
+                recordClusterCulling(commandBuffer);
+            }
+        })
+            .write(clusterDrawResource, ResourceUsage::ComputeWrite)
+            .write(cullStatsResource, ResourceUsage::ComputeWrite);
+
+        // the visible count is read back once the frame retired
+        renderGraph.output(cullStatsResource, ResourceUsage::HostRead);
+    }
+
+    RenderGraph::Pass& scene = renderGraph.addPass("scene", [this](VkCommandBuffer commandBuffer)
+    {
+        recordScenePass(commandBuffer);
+    });
+    scene.write(swapChainResource, ResourceUsage::ColorAttachment).write(depthResource, ResourceUsage::DepthAttachment);
+    if (clusterCulling == ClusterCulling::Gpu)
+    {
+        scene.read(clusterDrawResource, ResourceUsage::IndirectRead);
+    }
+
+    renderGraph.output(swapChainResource, ResourceUsage::Present);
+    renderGraph.compile();
+
+    std::vector<std::string> schedule = renderGraph.dump();
+    for (size_t i = 0; i < (options.dumpRenderGraph ? schedule.size() : 1); ++i)
+    {
+        SDL_Log("%s", schedule[i].c_str());
+    }
+}
\ No newline at end of file
@@ -0,0 +1,116 @@
+#include "frame_scheduler.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+void FrameScheduler::init(VkDevice device, uint32_t framesInFlight)
+{
+    this->device = device;
+    this->framesInFlight = framesInFlight;
+
+    VkSemaphoreTypeCreateInfo typeInfo{};
+    typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+    typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+    typeInfo.initialValue = 0;
+
+    VkSemaphoreCreateInfo semaphoreInfo{};
+    semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    semaphoreInfo.pNext = &typeInfo;
+
+    if (vkCreateSemaphore(device, &semaphoreInfo, nullptr, &semaphore) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create frame timeline semaphore!");
+    }
+
+    statsBegin = Clock::now();
+}
+
+void FrameScheduler::cleanup()
+{
+    waitRetired(lastSubmittedFrame());
+    vkDestroySemaphore(device, semaphore, nullptr);
+}
+
+uint64_t FrameScheduler::beginFrame()
+{
+    if (nextFrame > framesInFlight)
+    {
+        uint64_t frame = nextFrame - framesInFlight;
+        if (!isRetired(frame))
+        {
+            auto start = Clock::now();
+            waitRetired(frame);
+            stats.waitMilliseconds += std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        }
+    }
+
+    return nextFrame;
+}
+
+void FrameScheduler::submitted()
+{
+    submitTimes[slot()] = Clock::now();
+    ++nextFrame;
+    ++stats.frameCount;
+}
+
+uint64_t FrameScheduler::retiredFrame()
+{
+    uint64_t value = 0;
+    if (vkGetSemaphoreCounterValue(device, semaphore, &value) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to read frame timeline semaphore!");
+    }
+
+    observeRetired(value);
+    return value;
+}
+
+bool FrameScheduler::isRetired(uint64_t frame)
+{
+    return frame <= observedRetired || frame <= retiredFrame();
+}
+
+void FrameScheduler::waitRetired(uint64_t frame)
+{
+    if (frame <= observedRetired)
+    {
+        return;
+    }
+
+    VkSemaphoreWaitInfo waitInfo{};
+    waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+    waitInfo.semaphoreCount = 1;
+    waitInfo.pSemaphores = &semaphore;
+    waitInfo.pValues = &frame;
+
+    if (vkWaitSemaphores(device, &waitInfo, UINT64_MAX) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to wait for frame timeline semaphore!");
+    }
+
+    retiredFrame();
+}
+
+void FrameScheduler::observeRetired(uint64_t retired)
+{
+    // frames retiring between two polls are all charged the time of the later poll
+    auto now = Clock::now();
+    for (uint64_t frame = observedRetired + 1; frame <= retired; ++frame)
+    {
+        stats.latencyMilliseconds += std::chrono::duration<double, std::milli>(now - submitTimes[(frame - 1) % framesInFlight]).count();
+        ++stats.latencySamples;
+    }
+    observedRetired = std::max(observedRetired, retired);
+}
+
+FrameStats FrameScheduler::takeStats()
+{
+    auto now = Clock::now();
+    FrameStats result = stats;
+    result.seconds = std::chrono::duration<double>(now - statsBegin).count();
+
+    stats = {};
+    statsBegin = now;
+    return result;
+}
\ No newline at end of file
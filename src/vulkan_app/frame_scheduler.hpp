@@ -0,0 +1,64 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+
+// deepest frames in flight the scheduler can be configured with
+const uint32_t MAX_FRAMES_IN_FLIGHT = 4;
+
+struct FrameStats
+{
+    uint32_t frameCount = 0;
+    double seconds = 0.0;
+    // time the cpu spent waiting for a frame slot to free up
+    double waitMilliseconds = 0.0;
+    // from submission until the cpu saw the frame retire
+    double latencyMilliseconds = 0.0;
+    uint32_t latencySamples = 0;
+};
+
+// paces frames with one timeline semaphore that counts retired frames,
+// frame N is numbered from 1 and may start once frame N - framesInFlight retired
+class FrameScheduler
+{
+public:
+    void init(VkDevice device, uint32_t framesInFlight);
+    void cleanup();
+
+    // waits until the slot of the next frame is free and returns the frame number
+    uint64_t beginFrame();
+    // slot of the frame being recorded, indexes per-frame resources
+    uint32_t slot() const { return static_cast<uint32_t>((nextFrame - 1) % framesInFlight); }
+    // the submission of the frame signals its number on this semaphore
+    VkSemaphore timeline() const { return semaphore; }
+    // a frame that was begun but never submitted keeps its number for the next attempt
+    void submitted();
+
+    uint64_t lastSubmittedFrame() const { return nextFrame - 1; }
+    uint64_t retiredFrame();
+    bool isRetired(uint64_t frame);
+    void waitRetired(uint64_t frame);
+
+    uint32_t getFramesInFlight() const { return framesInFlight; }
+    // counters since the previous call
+    FrameStats takeStats();
+
+private:
+    using Clock = std::chrono::high_resolution_clock;
+
+    void observeRetired(uint64_t retired);
+
+    VkDevice device = VK_NULL_HANDLE;
+    VkSemaphore semaphore = VK_NULL_HANDLE;
+    uint32_t framesInFlight = 2;
+
+    uint64_t nextFrame = 1;
+    uint64_t observedRetired = 0;
+    std::array<Clock::time_point, MAX_FRAMES_IN_FLIGHT> submitTimes{};
+
+    FrameStats stats;
+    Clock::time_point statsBegin;
+};
\ No newline at end of file
@@ -0,0 +1,260 @@
+#include "ktx2.hpp"
+#include "mapped_file.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+static const uint8_t KTX2_IDENTIFIER[12] = {0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n'};
+
+struct Ktx2Header
+{
+    uint8_t identifier[12];
+    uint32_t vkFormat;
+    uint32_t typeSize;
+    uint32_t pixelWidth;
+    uint32_t pixelHeight;
+    uint32_t pixelDepth;
+    uint32_t layerCount;
+    uint32_t faceCount;
+    uint32_t levelCount;
+    uint32_t supercompressionScheme;
+    uint32_t dfdByteOffset;
+    uint32_t dfdByteLength;
+    uint32_t kvdByteOffset;
+    uint32_t kvdByteLength;
+    uint64_t sgdByteOffset;
+    uint64_t sgdByteLength;
+};
+
+struct Ktx2LevelIndex
+{
+    uint64_t byteOffset;
+    uint64_t byteLength;
+    uint64_t uncompressedByteLength;
+};
+
+// khronos data format descriptor values, only the ones written below
+static const uint32_t KHR_DF_VERSION_1_3 = 2;
+static const uint32_t KHR_DF_MODEL_RGBSDA = 1;
+static const uint32_t KHR_DF_MODEL_BC1A = 128;
+static const uint32_t KHR_DF_MODEL_BC7 = 134;
+static const uint32_t KHR_DF_PRIMARIES_BT709 = 1;
+static const uint32_t KHR_DF_TRANSFER_LINEAR = 1;
+static const uint32_t KHR_DF_TRANSFER_SRGB = 2;
+static const uint32_t KHR_DF_CHANNEL_ALPHA = 15;
+static const uint32_t KHR_DF_SAMPLE_DATATYPE_LINEAR = 0x10;
+
+bool isKtx2FormatSupported(VkFormat format)
+{
+    switch (format)
+    {
+    case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+    case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+    case VK_FORMAT_BC7_UNORM_BLOCK:
+    case VK_FORMAT_BC7_SRGB_BLOCK:
+    case VK_FORMAT_R8G8B8A8_UNORM:
+    case VK_FORMAT_R8G8B8A8_SRGB:
+        return true;
+    default:
+        return false;
+    }
+}
+
+bool isBlockCompressed(VkFormat format)
+{
+    return format != VK_FORMAT_R8G8B8A8_UNORM && format != VK_FORMAT_R8G8B8A8_SRGB;
+}
+
+uint32_t formatBlockSize(VkFormat format)
+{
+    switch (format)
+    {
+    case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+    case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+        return 8;
+    case VK_FORMAT_BC7_UNORM_BLOCK:
+    case VK_FORMAT_BC7_SRGB_BLOCK:
+        return 16;
+    default:
+        return 4;
+    }
+}
+
+size_t levelSize(VkFormat format, uint32_t width, uint32_t height)
+{
+    if (isBlockCompressed(format))
+    {
+        return static_cast<size_t>((width + 3) / 4) * ((height + 3) / 4) * formatBlockSize(format);
+    }
+    return static_cast<size_t>(width) * height * formatBlockSize(format);
+}
+
+static bool isSrgb(VkFormat format)
+{
+    return format == VK_FORMAT_BC1_RGB_SRGB_BLOCK || format == VK_FORMAT_BC7_SRGB_BLOCK || format == VK_FORMAT_R8G8B8A8_SRGB;
+}
+
+// basic data format descriptor, required by the container even though the vulkan format says it all
+static std::vector<uint32_t> makeDataFormatDescriptor(VkFormat format)
+{
+    bool compressed = isBlockCompressed(format);
+    uint32_t sampleCount = compressed ? 1 : 4;
+    uint32_t blockSize = formatBlockSize(format);
+
+    uint32_t colorModel = KHR_DF_MODEL_RGBSDA;
+    if (compressed)
+    {
+        colorModel = blockSize == 8 ? KHR_DF_MODEL_BC1A : KHR_DF_MODEL_BC7;
+    }
+    uint32_t transfer = isSrgb(format) ? KHR_DF_TRANSFER_SRGB : KHR_DF_TRANSFER_LINEAR;
+    uint32_t blockDimension = compressed ? 3 : 0;
+
+    std::vector<uint32_t> words;
+    words.push_back(0);
+    words.push_back(0);
+    words.push_back(KHR_DF_VERSION_1_3 | ((24 + 16 * sampleCount) << 16));
+    words.push_back(colorModel | (KHR_DF_PRIMARIES_BT709 << 8) | (transfer << 16));
+    words.push_back(blockDimension | (blockDimension << 8));
+    words.push_back(blockSize);
+    words.push_back(0);
+
+    if (compressed)
+    {
+        words.push_back((blockSize * 8 - 1) << 16);
+        words.push_back(0);
+        words.push_back(0);
+        words.push_back(UINT32_MAX);
+    }
+    else
+    {
+        for (uint32_t channel = 0; channel < 4; ++channel)
+        {
+            // alpha stays linear in srgb formats
+            uint32_t channelType = channel == 3 ? KHR_DF_CHANNEL_ALPHA : channel;
+            if (channel == 3 && isSrgb(format))
+            {
+                channelType |= KHR_DF_SAMPLE_DATATYPE_LINEAR;
+            }
+            words.push_back((channel * 8) | (7 << 16) | (channelType << 24));
+            words.push_back(0);
+            words.push_back(0);
+            words.push_back(255);
+        }
+    }
+
+    words[0] = static_cast<uint32_t>(words.size() * sizeof(uint32_t));
+    return words;
+}
+
+bool parseKtx2(const uint8_t* data, size_t size, Ktx2Texture& texture)
+{
+    if (size < sizeof(Ktx2Header))
+    {
+        return false;
+    }
+
+    Ktx2Header header;
+    memcpy(&header, data, sizeof(header));
+
+    if (memcmp(header.identifier, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER)) != 0)
+    {
+        return false;
+    }
+
+    // 2d textures without supercompression only, as written by texcook
+    VkFormat format = static_cast<VkFormat>(header.vkFormat);
+    if (!isKtx2FormatSupported(format) || header.supercompressionScheme != 0 || header.pixelDepth != 0 ||
+        header.layerCount > 1 || header.faceCount != 1 || header.levelCount == 0 ||
+        header.pixelWidth == 0 || header.pixelHeight == 0)
+    {
+        return false;
+    }
+
+    // no more levels than the chain down to 1x1 has, the shifts below stay defined
+    uint32_t maxLevels = 1;
+    for (uint32_t extent = std::max(header.pixelWidth, header.pixelHeight); extent > 1; extent >>= 1)
+    {
+        ++maxLevels;
+    }
+    if (header.levelCount > maxLevels)
+    {
+        return false;
+    }
+
+    size_t indexEnd = sizeof(Ktx2Header) + header.levelCount * sizeof(Ktx2LevelIndex);
+    if (indexEnd > size)
+    {
+        return false;
+    }
+
+    texture.format = format;
+    texture.width = header.pixelWidth;
+    texture.height = header.pixelHeight;
+    texture.levels.resize(header.levelCount);
+
+    for (uint32_t i = 0; i < header.levelCount; ++i)
+    {
+        Ktx2LevelIndex index;
+        memcpy(&index, data + sizeof(Ktx2Header) + i * sizeof(Ktx2LevelIndex), sizeof(index));
+
+        TextureLevel& level = texture.levels[i];
+        level.width = std::max(header.pixelWidth >> i, 1u);
+        level.height = std::max(header.pixelHeight >> i, 1u);
+        level.size = levelSize(format, level.width, level.height);
+
+        if (index.byteLength != level.size || index.byteOffset > size || index.byteLength > size - index.byteOffset)
+        {
+            return false;
+        }
+        level.data = data + index.byteOffset;
+    }
+
+    return true;
+}
+
+bool writeKtx2(const std::string& path, VkFormat format, uint32_t width, uint32_t height, const std::vector<std::vector<uint8_t>>& levels)
+{
+    std::vector<uint32_t> dfd = makeDataFormatDescriptor(format);
+
+    Ktx2Header header{};
+    memcpy(header.identifier, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER));
+    header.vkFormat = static_cast<uint32_t>(format);
+    header.typeSize = 1;
+    header.pixelWidth = width;
+    header.pixelHeight = height;
+    header.pixelDepth = 0;
+    header.layerCount = 0;
+    header.faceCount = 1;
+    header.levelCount = static_cast<uint32_t>(levels.size());
+    header.supercompressionScheme = 0;
+    header.dfdByteOffset = static_cast<uint32_t>(sizeof(Ktx2Header) + levels.size() * sizeof(Ktx2LevelIndex));
+    header.dfdByteLength = static_cast<uint32_t>(dfd.size() * sizeof(uint32_t));
+
+    // levels are stored smallest first, each aligned to the block size and to 4 bytes
+    uint64_t alignment = std::max(formatBlockSize(format), 4u);
+    std::vector<Ktx2LevelIndex> index(levels.size());
+    uint64_t offset = header.dfdByteOffset + header.dfdByteLength;
+    for (size_t i = levels.size(); i-- > 0;)
+    {
+        offset = (offset + alignment - 1) / alignment * alignment;
+        index[i].byteOffset = offset;
+        index[i].byteLength = levels[i].size();
+        index[i].uncompressedByteLength = levels[i].size();
+        offset += levels[i].size();
+    }
+
+    // laid out in memory first, the padding before each level stays zeroed
+    std::vector<uint8_t> file(offset, 0);
+    memcpy(file.data(), &header, sizeof(header));
+    memcpy(file.data() + sizeof(header), index.data(), index.size() * sizeof(Ktx2LevelIndex));
+    memcpy(file.data() + header.dfdByteOffset, dfd.data(), dfd.size() * sizeof(uint32_t));
+    for (size_t i = 0; i < levels.size(); ++i)
+    {
+        if (!levels[i].empty())
+        {
+            memcpy(file.data() + index[i].byteOffset, levels[i].data(), levels[i].size());
+        }
+    }
+
+    return writeFileAtomically(path, file.data(), file.size());
+}
\ No newline at end of file
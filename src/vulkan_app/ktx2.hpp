@@ -0,0 +1,37 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+// one mip level, rows of texels or of 4x4 blocks packed without padding
+struct TextureLevel
+{
+    uint32_t width;
+    uint32_t height;
+    const uint8_t* data;
+    size_t size;
+};
+
+// a 2d texture with a single layer and face, levels point into the parsed file
+struct Ktx2Texture
+{
+    VkFormat format;
+    uint32_t width;
+    uint32_t height;
+    std::vector<TextureLevel> levels;
+};
+
+// formats written by texcook and accepted by the loader
+bool isKtx2FormatSupported(VkFormat format);
+bool isBlockCompressed(VkFormat format);
+// bytes per 4x4 block of compressed formats, per texel otherwise
+uint32_t formatBlockSize(VkFormat format);
+size_t levelSize(VkFormat format, uint32_t width, uint32_t height);
+
+// false when the file is not a ktx2 texture this loader understands
+bool parseKtx2(const uint8_t* data, size_t size, Ktx2Texture& texture);
+bool writeKtx2(const std::string& path, VkFormat format, uint32_t width, uint32_t height, const std::vector<std::vector<uint8_t>>& levels);
\ No newline at end of file
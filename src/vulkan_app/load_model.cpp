@@ -1,30 +1,46 @@
 #include "load_model.hpp"
+#include "mesh_weld.hpp"
+#include "mesh_optimizer.hpp"
 #include <array>
+#include <string>
+#include <cstdio>
+#include <numeric>
+#include <algorithm>
 
-void Model::processNode(aiNode *node, const aiScene *scene, aiMatrix4x4 transform)
+glm::mat4 aiMatrix4x4ToGlm(const aiMatrix4x4& from)
 {
-    transform *= node->mTransformation;
-    for (uint32_t i = 0; i < node->mNumMeshes; ++i)
-    {
-        aiMesh *mesh = scene->mMeshes[node->mMeshes[i]];
-        meshes.push_back(processMesh(mesh, scene, transform));
-    }
+    // assimp matrices are row-major, glm matrices are column-major
+    return glm::mat4(
+        from.a1, from.b1, from.c1, from.d1,
+        from.a2, from.b2, from.c2, from.d2,
+        from.a3, from.b3, from.c3, from.d3,
+        from.a4, from.b4, from.c4, from.d4);
+}
 
-    for (uint32_t i = 0; i < node->mNumChildren; ++i)
-    {
-        processNode(node->mChildren[i], scene, transform);
-    }
+// number of vertices or faces converted by one task
+static const uint32_t IMPORT_CHUNK_SIZE = 16384;
+
+// a slice of the vertices or faces of one job, written to a fixed place in the output
+struct ImportChunk
+{
+    uint32_t job;
+    uint32_t first;
+    uint32_t count;
+    bool faces;
+};
+
+static bool isTriangleMesh(const aiMesh *mesh)
+{
+    return mesh->mPrimitiveTypes == aiPrimitiveType_TRIANGLE;
 }
 
-Mesh Model::processMesh(aiMesh *mesh, const aiScene *scene, aiMatrix4x4 transform)
+static void convertVertices(const aiMesh *mesh, uint32_t first, uint32_t count, Vertex* out)
 {
-    std::vector<Vertex> vertices;
-    std::vector<uint32_t> indices;
-    //std::vector<Texture2D> textures;
+    const aiVector3D* texCoords = mesh->mTextureCoords[0];
 
-    for (uint32_t i = 0; i < mesh->mNumVertices; ++i)
+    for (uint32_t i = first; i < first + count; ++i)
     {
-        Vertex vertex;
+        Vertex vertex{};
 
         vertex.pos.x = mesh->mVertices[i].x;
         vertex.pos.y = mesh->mVertices[i].y;
@@ -35,44 +51,425 @@ Mesh Model::processMesh(aiMesh *mesh, const aiScene *scene, aiMatrix4x4 transfor
         //vertex.normal.y = mesh->mNormals[i].y;
         //vertex.normal.z = mesh->mNormals[i].z;
 
-        if (mesh->mTextureCoords[0])
+        if (texCoords)
+        {
+            vertex.texCoord.x = texCoords[i].x;
+            vertex.texCoord.y = texCoords[i].y;
+        }
+
+        *out++ = vertex;
+    }
+}
+
+static void convertFaces(const aiMesh *mesh, uint32_t first, uint32_t count, uint32_t* out)
+{
+    for (uint32_t i = first; i < first + count; ++i)
+    {
+        const aiFace& face = mesh->mFaces[i];
+        for (uint32_t j = 0; j < face.mNumIndices; ++j)
+        {
+            *out++ = face.mIndices[j];
+        }
+    }
+}
+
+void Model::processScene(const aiScene *scene, ThreadPool* pool)
+{
+    std::vector<MeshImportJob> jobs;
+    processNode(scene->mRootNode, scene, scene->mRootNode->mTransformation, jobs);
+    processMeshes(jobs, pool);
+}
+
+void Model::processNode(aiNode *node, const aiScene *scene, aiMatrix4x4 transform, std::vector<MeshImportJob>& jobs)
+{
+    transform *= node->mTransformation;
+    for (uint32_t i = 0; i < node->mNumMeshes; ++i)
+    {
+        jobs.push_back({scene->mMeshes[node->mMeshes[i]], transform});
+    }
+
+    for (uint32_t i = 0; i < node->mNumChildren; ++i)
+    {
+        processNode(node->mChildren[i], scene, transform, jobs);
+    }
+}
+
+void Model::processMeshes(const std::vector<MeshImportJob>& jobs, ThreadPool* pool)
+{
+    meshes.clear();
+    meshes.resize(jobs.size());
+
+    // size every output up front, so the chunks below can be converted in any order
+    std::vector<ImportChunk> chunks;
+    for (uint32_t j = 0; j < jobs.size(); ++j)
+    {
+        const aiMesh *mesh = jobs[j].mesh;
+
+        size_t indexCount = 0;
+        if (isTriangleMesh(mesh))
         {
-            vertex.texCoord.x = mesh->mTextureCoords[0][i].x;
-            vertex.texCoord.y = mesh->mTextureCoords[0][i].y;
+            indexCount = static_cast<size_t>(mesh->mNumFaces) * 3;
         }
         else
         {
-            vertex.texCoord = glm::vec2(0.f, 0.f);
+            for (uint32_t i = 0; i < mesh->mNumFaces; ++i)
+            {
+                indexCount += mesh->mFaces[i].mNumIndices;
+            }
+        }
+
+        meshes[j].m_transform = aiMatrix4x4ToGlm(jobs[j].transform);
+        meshes[j].vertices.resize(mesh->mNumVertices);
+        meshes[j].indices.resize(indexCount);
+
+        for (uint32_t first = 0; first < mesh->mNumVertices; first += IMPORT_CHUNK_SIZE)
+        {
+            chunks.push_back({j, first, std::min(IMPORT_CHUNK_SIZE, mesh->mNumVertices - first), false});
         }
 
-        vertices.push_back(vertex);
+        if (isTriangleMesh(mesh))
+        {
+            for (uint32_t first = 0; first < mesh->mNumFaces; first += IMPORT_CHUNK_SIZE)
+            {
+                chunks.push_back({j, first, std::min(IMPORT_CHUNK_SIZE, mesh->mNumFaces - first), true});
+            }
+        }
+        else if (mesh->mNumFaces > 0)
+        {
+            // mixed primitive sizes have no fixed output offset per face
+            chunks.push_back({j, 0, mesh->mNumFaces, true});
+        }
     }
 
-    for (uint32_t i = 0; i < mesh->mNumFaces; ++i)
+    auto convertChunk = [&](uint32_t c)
     {
-        auto face = mesh->mFaces[i];
-        for (uint32_t j = 0; j < face.mNumIndices; ++j)
+        const ImportChunk& chunk = chunks[c];
+        const aiMesh *mesh = jobs[chunk.job].mesh;
+        Mesh& output = meshes[chunk.job];
+
+        if (chunk.faces)
+        {
+            size_t firstIndex = isTriangleMesh(mesh) ? static_cast<size_t>(chunk.first) * 3 : 0;
+            convertFaces(mesh, chunk.first, chunk.count, output.indices.data() + firstIndex);
+        }
+        else
+        {
+            convertVertices(mesh, chunk.first, chunk.count, output.vertices.data() + chunk.first);
+        }
+    };
+
+    if (pool)
+    {
+        pool->parallelFor(static_cast<uint32_t>(chunks.size()), convertChunk);
+    }
+    else
+    {
+        for (uint32_t c = 0; c < chunks.size(); ++c)
+        {
+            convertChunk(c);
+        }
+    }
+}
+
+static void computeBounds(const std::vector<Vertex>& vertices, MeshRange& range)
+{
+    glm::vec3 boundsMin(0.f);
+    glm::vec3 boundsMax(0.f);
+    if (!vertices.empty())
+    {
+        boundsMin = boundsMax = vertices[0].pos;
+        for (const auto& vertex : vertices)
+        {
+            boundsMin = glm::min(boundsMin, vertex.pos);
+            boundsMax = glm::max(boundsMax, vertex.pos);
+        }
+    }
+    range.boundsMin = glm::vec4(boundsMin, 0.f);
+    range.boundsMax = glm::vec4(boundsMax, 0.f);
+}
+
+void packMeshes(std::vector<Mesh>& meshes, VertexFormat vertexFormat, PackedGeometry& geometry)
+{
+    auto fitsIndex16 = [](const Mesh& mesh)
+    {
+        return mesh.vertices.size() <= INDEX16_VERTEX_LIMIT;
+    };
+
+    size_t totalVertices = 0;
+    size_t totalIndices16 = 0;
+    size_t totalIndices32 = 0;
+    size_t meshes32 = 0;
+    for (const auto& mesh : meshes)
+    {
+        size_t meshIndices = mesh.indices.size();
+        for (const auto& lod : mesh.lods)
+        {
+            meshIndices += lod.indices.size();
+        }
+
+        totalVertices += mesh.vertices.size();
+        if (fitsIndex16(mesh))
+        {
+            totalIndices16 += meshIndices;
+        }
+        else
+        {
+            totalIndices32 += meshIndices;
+            ++meshes32;
+        }
+    }
+
+    if (totalVertices > UINT32_MAX || totalIndices16 > UINT32_MAX || totalIndices32 > UINT32_MAX)
+    {
+        throw std::runtime_error("model is too large to pack into one buffer!");
+    }
+
+    geometry.vertexFormat = vertexFormat;
+    geometry.vertices.clear();
+    geometry.compactVertices.clear();
+    geometry.indices16.clear();
+    geometry.indices32.clear();
+    geometry.meshlets.clear();
+    geometry.ranges.clear();
+    geometry.ranges.reserve(meshes.size());
+
+    // full vertices of a single mesh and 32-bit indices of a single large mesh without levels of detail
+    // are taken as is, everything else is converted or concatenated
+    bool moveVertices = vertexFormat == VertexFormat::Full && meshes.size() == 1;
+    bool moveIndices32 = meshes32 == 1 &&
+        std::find_if_not(meshes.begin(), meshes.end(), fitsIndex16)->indices.size() == totalIndices32;
+    if (vertexFormat == VertexFormat::Compact)
+    {
+        geometry.compactVertices.reserve(totalVertices);
+    }
+    else if (!moveVertices)
+    {
+        geometry.vertices.reserve(totalVertices);
+    }
+    geometry.indices16.reserve(totalIndices16);
+    if (!moveIndices32)
+    {
+        geometry.indices32.reserve(totalIndices32);
+    }
+
+    // meshes indexed with 16 bits first, each index type then forms one contiguous run of draws
+    std::vector<uint32_t> order(meshes.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_partition(order.begin(), order.end(), [&](uint32_t i) { return fitsIndex16(meshes[i]); });
+
+    uint32_t firstVertex = 0;
+    for (uint32_t i : order)
+    {
+        Mesh& mesh = meshes[i];
+
+        MeshRange range{};
+        range.transform = mesh.m_transform;
+        computeBounds(mesh.vertices, range);
+        range.firstVertex = firstVertex;
+        range.vertexCount = static_cast<uint32_t>(mesh.vertices.size());
+        range.indexCount = static_cast<uint32_t>(mesh.indices.size());
+
+        // the full mesh and its levels of detail, back to back in the index array of the mesh's type
+        auto appendIndices = [&](const std::vector<uint32_t>& indices)
+        {
+            if (range.indexType == VK_INDEX_TYPE_UINT16)
+            {
+                uint32_t first = static_cast<uint32_t>(geometry.indices16.size());
+                for (uint32_t index : indices)
+                {
+                    geometry.indices16.push_back(static_cast<uint16_t>(index));
+                }
+                return first;
+            }
+
+            uint32_t first = static_cast<uint32_t>(geometry.indices32.size());
+            geometry.indices32.insert(geometry.indices32.end(), indices.begin(), indices.end());
+            return first;
+        };
+
+        range.indexType = fitsIndex16(mesh) ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+        if (range.indexType == VK_INDEX_TYPE_UINT32 && moveIndices32)
+        {
+            range.firstIndex = 0;
+            geometry.indices32 = std::move(mesh.indices);
+        }
+        else
+        {
+            range.firstIndex = appendIndices(mesh.indices);
+        }
+
+        range.lodCount = 1;
+        range.lods[0] = {range.firstIndex, range.indexCount, 0.f};
+        for (const auto& lod : mesh.lods)
+        {
+            if (range.lodCount == MAX_MESH_LODS)
+            {
+                break;
+            }
+            uint32_t lodFirstIndex = appendIndices(lod.indices);
+            range.lods[range.lodCount++] = {lodFirstIndex, static_cast<uint32_t>(lod.indices.size()), lod.error};
+        }
+
+        if (vertexFormat == VertexFormat::Compact)
+        {
+            compressVertices(mesh.vertices, glm::vec3(range.boundsMin), glm::vec3(range.boundsMax), geometry.compactVertices);
+        }
+        else if (moveVertices)
+        {
+            geometry.vertices = std::move(mesh.vertices);
+        }
+        else
+        {
+            geometry.vertices.insert(geometry.vertices.end(), std::make_move_iterator(mesh.vertices.begin()), std::make_move_iterator(mesh.vertices.end()));
+        }
+
+        range.firstMeshlet = static_cast<uint32_t>(geometry.meshlets.size());
+        range.meshletCount = static_cast<uint32_t>(mesh.meshlets.size());
+        for (auto meshlet : mesh.meshlets)
+        {
+            meshlet.firstIndex += range.firstIndex;
+            meshlet.vertexOffset = range.firstVertex;
+            meshlet.mesh = static_cast<uint32_t>(geometry.ranges.size());
+            geometry.meshlets.push_back(meshlet);
+        }
+
+        // release the source right away so peak memory stays close to one copy of the model
+        std::vector<Vertex>().swap(mesh.vertices);
+        std::vector<uint32_t>().swap(mesh.indices);
+        std::vector<Meshlet>().swap(mesh.meshlets);
+        std::vector<LodLevel>().swap(mesh.lods);
+
+        geometry.ranges.push_back(range);
+        firstVertex += range.vertexCount;
+    }
+}
+
+void postProcessMeshes(std::vector<Mesh>& meshes, const MeshProcessOptions& options, ThreadPool& pool)
+{
+    if (options.weld)
+    {
+        std::vector<WeldStats> weldStats(meshes.size());
+        pool.parallelFor(static_cast<uint32_t>(meshes.size()), [&](uint32_t i)
+        {
+            weldStats[i] = weldVertices(meshes[i].vertices, meshes[i].indices, options.weldEpsilon);
+        });
+
+        size_t verticesBefore = 0;
+        size_t verticesAfter = 0;
+        for (size_t i = 0; i < meshes.size(); ++i)
+        {
+            SDL_Log("  mesh %zu: %u -> %u vertices", i, weldStats[i].verticesBefore, weldStats[i].verticesAfter);
+            verticesBefore += weldStats[i].verticesBefore;
+            verticesAfter += weldStats[i].verticesAfter;
+        }
+
+        SDL_Log("welded %zu meshes: %zu -> %zu vertices, saved %.1f KiB", meshes.size(), verticesBefore, verticesAfter,
+            (verticesBefore - verticesAfter) * sizeof(Vertex) / 1024.f);
+    }
+
+    if (options.optimizeIndices)
+    {
+        std::vector<VertexCacheStats> statsBefore(meshes.size());
+        std::vector<VertexCacheStats> statsAfter(meshes.size());
+        pool.parallelFor(static_cast<uint32_t>(meshes.size()), [&](uint32_t i)
+        {
+            Mesh& mesh = meshes[i];
+            uint32_t vertexCount = static_cast<uint32_t>(mesh.vertices.size());
+            statsBefore[i] = analyzeVertexCache(mesh.indices, vertexCount);
+
+            std::vector<uint32_t> clusters;
+            optimizeVertexCache(mesh.indices, vertexCount, &clusters);
+            optimizeOverdraw(mesh.indices, mesh.vertices, clusters);
+            optimizeVertexFetch(mesh.vertices, mesh.indices);
+
+            statsAfter[i] = analyzeVertexCache(mesh.indices, static_cast<uint32_t>(mesh.vertices.size()));
+        });
+
+        SDL_Log("optimized index order of %zu meshes for a %u entry vertex cache", meshes.size(), VERTEX_CACHE_SIZE);
+        for (size_t i = 0; i < meshes.size(); ++i)
+        {
+            SDL_Log("  mesh %zu: ACMR %.3f -> %.3f, ATVR %.3f -> %.3f", i,
+                statsBefore[i].acmr, statsAfter[i].acmr, statsBefore[i].atvr, statsAfter[i].atvr);
+        }
+    }
+
+    // after index optimization, meshlets follow the final triangle order; they cover the full-detail mesh only
+    if (options.buildMeshlets)
+    {
+        pool.parallelFor(static_cast<uint32_t>(meshes.size()), [&](uint32_t i)
         {
-            indices.push_back(face.mIndices[j]);
+            meshes[i].meshlets = buildMeshlets(meshes[i].vertices, meshes[i].indices);
+        });
+
+        size_t meshletCount = 0;
+        size_t triangleCount = 0;
+        for (const auto& mesh : meshes)
+        {
+            meshletCount += mesh.meshlets.size();
+            triangleCount += mesh.indices.size() / 3;
         }
+
+        SDL_Log("built %zu meshlets, %.1f triangles per meshlet on average", meshletCount,
+            meshletCount > 0 ? static_cast<float>(triangleCount) / meshletCount : 0.f);
     }
 
-/* to-do
-    if (mesh->mMaterialIndex >= 0)
+    if (options.lodLevels > 0)
     {
-        auto *material = scene->mMaterials[mesh->mMaterialIndex];
-        for (auto it = texTypesImage.begin(); it != texTypesImage.end(); it++)
+        pool.parallelFor(static_cast<uint32_t>(meshes.size()), [&](uint32_t i)
         {
-            loadMatTextures(textures, scene, material, it->first, it->second);
+            meshes[i].lods = buildLodChain(meshes[i].vertices, meshes[i].indices, options.lodLevels);
+        });
+
+        SDL_Log("built levels of detail for %zu meshes", meshes.size());
+        for (size_t i = 0; i < meshes.size(); ++i)
+        {
+            std::string chain = std::to_string(meshes[i].indices.size() / 3);
+            for (const auto& lod : meshes[i].lods)
+            {
+                char level[64];
+                snprintf(level, sizeof(level), " -> %zu (error %g)", lod.indices.size() / 3, lod.error);
+                chain += level;
+            }
+            SDL_Log("  mesh %zu: %s triangles", i, chain.c_str());
         }
     }
-*/
-    return Mesh(vertices, indices);
 }
 
 void VulkanApp::loadModel()
 {
-    Model model(MODEL_PATH.c_str());
-    vertices = model.meshes[0].vertices;
-    indices = model.meshes[0].indices;
+    MeshCacheKey cacheKey{};
+    cacheKey.sourceHash = MeshCache::hashFile(MODEL_PATH);
+    cacheKey.processHash = MeshCache::hashOptions(options.meshProcessing);
+    cacheKey.importFlags = MODEL_IMPORT_FLAGS;
+    cacheKey.vertexFormat = options.meshProcessing.vertexFormat;
+
+    if (meshCache.open(MODEL_CACHE_PATH, cacheKey))
+    {
+        SDL_Log("loaded mesh cache %s", MODEL_CACHE_PATH.c_str());
+
+        // warm path: buffers are filled straight from the mapping
+        geometryView = meshCache.view();
+        meshRanges.assign(meshCache.ranges(), meshCache.ranges() + meshCache.meshCount());
+        return;
+    }
+
+    {
+        auto importStart = std::chrono::high_resolution_clock::now();
+
+        Model model(MODEL_PATH.c_str(), &threadPool);
+        postProcessMeshes(model.meshes, options.meshProcessing, threadPool);
+        packMeshes(model.meshes, options.meshProcessing.vertexFormat, geometry);
+
+        auto importEnd = std::chrono::high_resolution_clock::now();
+        SDL_Log("imported %s in %.2f ms on %u threads", MODEL_PATH.c_str(),
+            std::chrono::duration<float, std::chrono::milliseconds::period>(importEnd - importStart).count(), threadPool.size());
+    }
+
+    if (!MeshCache::write(MODEL_CACHE_PATH, cacheKey, geometry))
+    {
+        SDL_Log("failed to write mesh cache %s", MODEL_CACHE_PATH.c_str());
+    }
+
+    geometryView = geometry.view();
+    meshRanges = geometry.ranges;
 }
\ No newline at end of file
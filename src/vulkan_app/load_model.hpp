@@ -5,9 +5,15 @@
 #include "assimp/postprocess.h"
 #include "vulkan_app.hpp"
 #include "vertex_data.hpp"
+#include "packed_geometry.hpp"
+#include "meshlets.hpp"
+#include "mesh_simplifier.hpp"
+#include "thread_pool.hpp"
 #include <map>
 #include <filesystem>
 
+const uint32_t MODEL_IMPORT_FLAGS = aiProcess_Triangulate | aiProcess_FlipUVs | aiProcess_GenNormals;
+
 glm::mat4 aiMatrix4x4ToGlm(const aiMatrix4x4& from);
 
 class Mesh
@@ -16,6 +22,10 @@ public:
     glm::mat4x4 m_transform;
     std::vector<Vertex> vertices;
     std::vector<uint32_t> indices;
+    std::vector<Meshlet> meshlets;
+    // simplified levels below the full mesh, sharing its vertices
+    std::vector<LodLevel> lods;
+    Mesh(): m_transform(1.f) {}
     Mesh(std::vector<Vertex>& vertices_, std::vector<uint32_t>& indices_): 
         vertices(std::move(vertices_)), indices(std::move(indices_))
     {
@@ -24,14 +34,21 @@ public:
     }
 };
 
+// one aiMesh instance together with its accumulated node transform
+struct MeshImportJob
+{
+    const aiMesh* mesh;
+    aiMatrix4x4 transform;
+};
+
 class Model
 {
 private:
 
-    void load(const char* path)
+    void load(const char* path, ThreadPool* pool)
     {
         Assimp::Importer importer;
-        const aiScene *scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_FlipUVs | aiProcess_GenNormals);
+        const aiScene *scene = importer.ReadFile(path, MODEL_IMPORT_FLAGS);
 
         if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode)
         {
@@ -53,7 +70,7 @@ private:
         scene->mMetaData->Get<int>("CoordAxis", coordAxis);
         int coordAxisSign = 1;
         scene->mMetaData->Get<int>("CoordAxisSign", coordAxisSign);
-        float scaleFactor;
+        float scaleFactor = 1.f;
         scene->mMetaData->Get<float>("UnitScaleFactor", scaleFactor);
 
         aiVector3D upVec = upAxis == 0 ? aiVector3D(upAxisSign,0,0) : upAxis == 1 ? aiVector3D(0, upAxisSign,0) : aiVector3D(0, 0, upAxisSign);
@@ -71,16 +88,24 @@ private:
         
         scene->mRootNode->mTransformation *= transMat;
         
-        processNode(scene->mRootNode, scene, scene->mRootNode->mTransformation);
+        processScene(scene, pool);
     }
-    void processNode(aiNode *node, const aiScene *scene, aiMatrix4x4 transform);
-    Mesh processMesh(aiMesh *mesh, const aiScene *scene, aiMatrix4x4 transform);
+    void processNode(aiNode *node, const aiScene *scene, aiMatrix4x4 transform, std::vector<MeshImportJob>& jobs);
+    void processMeshes(const std::vector<MeshImportJob>& jobs, ThreadPool* pool);
 public:
     std::vector<Mesh> meshes;
     std::string directory;
 
-    Model(const char *path)
+    Model() = default;
+    Model(const char *path, ThreadPool* pool = nullptr)
     {
-        load(path);
+        load(path, pool);
     }
-};
\ No newline at end of file
+
+    // converts every mesh of the scene, in parallel when a pool is given;
+    // the result does not depend on the pool or its size
+    void processScene(const aiScene *scene, ThreadPool* pool = nullptr);
+};
+
+void packMeshes(std::vector<Mesh>& meshes, VertexFormat vertexFormat, PackedGeometry& geometry);
+void postProcessMeshes(std::vector<Mesh>& meshes, const MeshProcessOptions& options, ThreadPool& pool);
\ No newline at end of file
@@ -0,0 +1,135 @@
+#include "vulkan_app.hpp"
+
+// keeps the projected distance away from zero when the camera enters the bounds of a mesh
+static const float MIN_LOD_DISTANCE = 1e-3f;
+
+void VulkanApp::createLodSelection()
+{
+    bool hasLods = std::any_of(meshRanges.begin(), meshRanges.end(), [](const MeshRange& range) { return range.lodCount > 1; });
+    if (!hasLods)
+    {
+        return;
+    }
+
+    // meshlets only cover the full meshes
+    if (clusterCulling != ClusterCulling::Off)
+    {
+        SDL_Log("levels of detail are not selected with cluster culling");
+        return;
+    }
+
+    lodSelection = true;
+    selectedLods.assign(framesInFlight, std::vector<uint32_t>(meshRanges.size(), 0));
+
+    // the static draws are replaced with ones rewritten by the cpu every frame
+    if (indirectBuffer == VK_NULL_HANDLE)
+    {
+        return;
+    }
+
+    VkDeviceSize drawBufferSize = sizeof(VkDrawIndexedIndirectCommand) * meshRanges.size();
+
+    CustomBufferCreateInfo customBufferInfo{};
+    customBufferInfo.size = drawBufferSize;
+    customBufferInfo.usage = VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT;
+    customBufferInfo.properties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+    customBufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    lodDrawBuffers.resize(framesInFlight);
+    lodDrawBuffersMemory.resize(framesInFlight);
+    lodDrawBuffersMapped.resize(framesInFlight);
+
+    for (size_t i = 0; i < framesInFlight; ++i)
+    {
+        createBuffer(customBufferInfo, lodDrawBuffers[i], lodDrawBuffersMemory[i]);
+        lodDrawBuffersMapped[i] = lodDrawBuffersMemory[i].mapped;
+    }
+}
+
+void VulkanApp::selectMeshLods(uint32_t frame)
+{
+    if (clusterCulling != ClusterCulling::Off)
+    {
+        return;
+    }
+
+    if (!lodSelection)
+    {
+        uint64_t triangles = 0;
+        for (const auto& range : meshRanges)
+        {
+            triangles += range.indexCount / 3;
+        }
+        addSubmittedTriangles(triangles);
+        return;
+    }
+
+    // world units at distance one to pixels
+    float projectionScale = std::abs(frameTransforms.proj[1][1]) * swapChainExtent.height * 0.5f;
+
+    auto draws = lodDrawBuffers.empty() ? nullptr : static_cast<VkDrawIndexedIndirectCommand*>(lodDrawBuffersMapped[frame]);
+    uint64_t triangles = 0;
+    for (size_t i = 0; i < meshRanges.size(); ++i)
+    {
+        const MeshRange& range = meshRanges[i];
+
+        // the largest scale of the model matrix grows the object space error of every level
+        glm::mat4 model = frameTransforms.model * range.transform;
+        float modelScale = std::max({glm::length(glm::vec3(model[0])), glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))});
+        glm::mat4 modelView = frameTransforms.view * model;
+
+        glm::vec3 center = (glm::vec3(range.boundsMin) + glm::vec3(range.boundsMax)) * 0.5f;
+        float radius = glm::length(glm::vec3(range.boundsMax) - center) * modelScale;
+        float distance = glm::length(glm::vec3(modelView * glm::vec4(center, 1.f))) - radius;
+        float pixelsPerUnit = modelScale * projectionScale / std::max(distance, MIN_LOD_DISTANCE);
+
+        // the coarsest level whose error stays below the threshold on screen
+        uint32_t lod = 0;
+        for (uint32_t j = range.lodCount; j-- > 1;)
+        {
+            if (range.lods[j].error * pixelsPerUnit <= options.lodPixelError)
+            {
+                lod = j;
+                break;
+            }
+        }
+
+        selectedLods[frame][i] = lod;
+        triangles += range.lods[lod].indexCount / 3;
+
+        if (draws)
+        {
+            draws[i].indexCount = range.lods[lod].indexCount;
+            draws[i].instanceCount = 1;
+            draws[i].firstIndex = range.lods[lod].firstIndex;
+            draws[i].vertexOffset = static_cast<int32_t>(range.firstVertex);
+            draws[i].firstInstance = static_cast<uint32_t>(i);
+        }
+    }
+
+    addSubmittedTriangles(triangles);
+}
+
+void VulkanApp::addSubmittedTriangles(uint64_t triangles)
+{
+    trianglesSubmitted += triangles;
+    ++triangleFrames;
+
+    float time = getTime();
+    if (time - lastTriangleReport >= 1.f)
+    {
+        SDL_Log("%.0f triangles submitted per frame", static_cast<double>(trianglesSubmitted) / triangleFrames);
+        trianglesSubmitted = 0;
+        triangleFrames = 0;
+        lastTriangleReport = time;
+    }
+}
+
+void VulkanApp::cleanupLodSelection()
+{
+    for (size_t i = 0; i < lodDrawBuffers.size(); ++i)
+    {
+        vkDestroyBuffer(device, lodDrawBuffers[i], nullptr);
+        memoryAllocator.free(lodDrawBuffersMemory[i]);
+    }
+}
\ No newline at end of file
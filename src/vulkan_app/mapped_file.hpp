@@ -0,0 +1,34 @@
+#pragma once
+
+#include <string>
+#include <cstddef>
+#include <cstdint>
+
+// read-only memory mapping of a whole file
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    ~MappedFile();
+
+    bool open(const std::string& path);
+    void close();
+
+    bool isOpen() const { return mapping != nullptr; }
+    const uint8_t* data() const { return static_cast<const uint8_t*>(mapping); }
+    size_t size() const { return mappingSize; }
+
+private:
+    void* mapping = nullptr;
+    size_t mappingSize = 0;
+
+#ifdef _WIN32
+    void* fileHandle = nullptr;
+    void* mappingHandle = nullptr;
+#endif
+};
+
+// writes next to the target and renames it into place, so a crash never leaves a half-written file behind
+bool writeFileAtomically(const std::string& path, const void* data, size_t size);
\ No newline at end of file
@@ -0,0 +1,573 @@
+#include "memory_allocator.hpp"
+
+#include <stdexcept>
+#include <algorithm>
+
+// second level lists per power of two
+static const uint32_t SL_LOG2 = 4;
+static const uint32_t SL_COUNT = 1 << SL_LOG2;
+// sizes below SMALL_SIZE are kept in linear lists of MIN_ALIGNMENT steps
+static const uint32_t SMALL_LOG2 = 8;
+static const VkDeviceSize SMALL_SIZE = VkDeviceSize(1) << SMALL_LOG2;
+static const VkDeviceSize MIN_ALIGNMENT = SMALL_SIZE / SL_COUNT;
+static const uint32_t FL_COUNT = 64 - SMALL_LOG2 + 1;
+static const uint32_t NO_REGION = UINT32_MAX;
+
+static const uint32_t DEDICATED_POOL = UINT32_MAX;
+static const VkDeviceSize DEFAULT_BLOCK_SIZE = VkDeviceSize(64) << 20;
+// heaps up to this size get blocks of an eighth of the heap
+static const VkDeviceSize SMALL_HEAP_SIZE = VkDeviceSize(1) << 30;
+
+static VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment)
+{
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+static uint32_t floorLog2(VkDeviceSize value)
+{
+    uint32_t result = 0;
+    for (uint32_t shift = 32; shift > 0; shift /= 2)
+    {
+        if (value >> shift)
+        {
+            value >>= shift;
+            result += shift;
+        }
+    }
+    return result;
+}
+
+static uint32_t lowestBit(uint64_t value)
+{
+    uint32_t result = 0;
+    while (!(value & 1))
+    {
+        value >>= 1;
+        ++result;
+    }
+    return result;
+}
+
+// list a free region of the given size belongs to
+static void mapping(VkDeviceSize size, uint32_t& fl, uint32_t& sl)
+{
+    if (size < SMALL_SIZE)
+    {
+        fl = 0;
+        sl = static_cast<uint32_t>(size / MIN_ALIGNMENT);
+        return;
+    }
+
+    uint32_t log2 = floorLog2(size);
+    fl = log2 - SMALL_LOG2 + 1;
+    sl = static_cast<uint32_t>(size >> (log2 - SL_LOG2)) - SL_COUNT;
+}
+
+// first list whose every region is large enough for the given size
+static void mappingSearch(VkDeviceSize size, uint32_t& fl, uint32_t& sl)
+{
+    if (size >= SMALL_SIZE)
+    {
+        size += (VkDeviceSize(1) << (floorLog2(size) - SL_LOG2)) - 1;
+    }
+    mapping(size, fl, sl);
+}
+
+// one VkDeviceMemory, split into physically linked regions, the free ones in segregated lists
+class MemoryBlock
+{
+public:
+    MemoryBlock(VkDeviceMemory memory, VkDeviceSize size, void* mapped);
+
+    bool allocate(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& offset, uint32_t& region);
+    // returns the size of the released region
+    VkDeviceSize free(uint32_t region);
+
+    bool isEmpty() const { return usedBytes == 0; }
+    VkDeviceSize largestFreeRegion() const;
+
+    VkDeviceMemory memory;
+    VkDeviceSize size;
+    void* mapped;
+    VkDeviceSize usedBytes = 0;
+
+private:
+    struct Region
+    {
+        VkDeviceSize offset;
+        VkDeviceSize size;
+        bool free;
+        uint32_t prevPhysical;
+        uint32_t nextPhysical;
+        uint32_t prevFree;
+        uint32_t nextFree;
+    };
+
+    uint32_t createRegion(VkDeviceSize offset, VkDeviceSize size);
+    void releaseRegion(uint32_t region);
+    void insertFree(uint32_t region);
+    void removeFree(uint32_t region);
+    uint32_t findFree(VkDeviceSize size) const;
+
+    std::vector<Region> regions;
+    std::vector<uint32_t> unusedRegions;
+    uint64_t flBitmap = 0;
+    uint32_t slBitmaps[FL_COUNT] = {};
+    uint32_t freeHeads[FL_COUNT][SL_COUNT];
+};
+
+MemoryBlock::MemoryBlock(VkDeviceMemory memory, VkDeviceSize size, void* mapped) :
+    memory(memory), size(size), mapped(mapped)
+{
+    for (auto& heads : freeHeads)
+    {
+        std::fill(std::begin(heads), std::end(heads), NO_REGION);
+    }
+    insertFree(createRegion(0, size));
+}
+
+uint32_t MemoryBlock::createRegion(VkDeviceSize offset, VkDeviceSize size)
+{
+    Region region{offset, size, true, NO_REGION, NO_REGION, NO_REGION, NO_REGION};
+    if (!unusedRegions.empty())
+    {
+        uint32_t index = unusedRegions.back();
+        unusedRegions.pop_back();
+        regions[index] = region;
+        return index;
+    }
+
+    regions.push_back(region);
+    return static_cast<uint32_t>(regions.size() - 1);
+}
+
+void MemoryBlock::releaseRegion(uint32_t region)
+{
+    unusedRegions.push_back(region);
+}
+
+void MemoryBlock::insertFree(uint32_t index)
+{
+    Region& region = regions[index];
+    uint32_t fl, sl;
+    mapping(region.size, fl, sl);
+
+    region.free = true;
+    region.prevFree = NO_REGION;
+    region.nextFree = freeHeads[fl][sl];
+    if (region.nextFree != NO_REGION)
+    {
+        regions[region.nextFree].prevFree = index;
+    }
+    freeHeads[fl][sl] = index;
+
+    flBitmap |= uint64_t(1) << fl;
+    slBitmaps[fl] |= 1u << sl;
+}
+
+void MemoryBlock::removeFree(uint32_t index)
+{
+    Region& region = regions[index];
+    uint32_t fl, sl;
+    mapping(region.size, fl, sl);
+
+    if (region.prevFree != NO_REGION)
+    {
+        regions[region.prevFree].nextFree = region.nextFree;
+    }
+    else
+    {
+        freeHeads[fl][sl] = region.nextFree;
+    }
+    if (region.nextFree != NO_REGION)
+    {
+        regions[region.nextFree].prevFree = region.prevFree;
+    }
+
+    if (freeHeads[fl][sl] == NO_REGION)
+    {
+        slBitmaps[fl] &= ~(1u << sl);
+        if (slBitmaps[fl] == 0)
+        {
+            flBitmap &= ~(uint64_t(1) << fl);
+        }
+    }
+    region.free = false;
+}
+
+uint32_t MemoryBlock::findFree(VkDeviceSize size) const
+{
+    uint32_t fl, sl;
+    mappingSearch(size, fl, sl);
+    if (fl >= FL_COUNT)
+    {
+        return NO_REGION;
+    }
+
+    uint32_t slMap = slBitmaps[fl] & (~0u << sl);
+    if (slMap == 0)
+    {
+        uint64_t flMap = fl + 1 < 64 ? flBitmap & (~uint64_t(0) << (fl + 1)) : 0;
+        if (flMap == 0)
+        {
+            return NO_REGION;
+        }
+        fl = lowestBit(flMap);
+        slMap = slBitmaps[fl];
+    }
+
+    return freeHeads[fl][lowestBit(slMap)];
+}
+
+bool MemoryBlock::allocate(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& offset, uint32_t& regionIndex)
+{
+    // regions start and end on MIN_ALIGNMENT, so larger alignments cost at most the difference
+    size = alignUp(size, MIN_ALIGNMENT);
+    alignment = std::max(alignment, MIN_ALIGNMENT);
+    VkDeviceSize searchSize = size + alignment - MIN_ALIGNMENT;
+    if (searchSize > this->size)
+    {
+        return false;
+    }
+
+    uint32_t index = findFree(searchSize);
+    if (index == NO_REGION)
+    {
+        return false;
+    }
+    removeFree(index);
+
+    // neighbours of a free region are never free, split-off parts can be linked in as free regions right away
+    VkDeviceSize padding = alignUp(regions[index].offset, alignment) - regions[index].offset;
+    if (padding > 0)
+    {
+        uint32_t before = createRegion(regions[index].offset, padding);
+        regions[before].prevPhysical = regions[index].prevPhysical;
+        regions[before].nextPhysical = index;
+        if (regions[index].prevPhysical != NO_REGION)
+        {
+            regions[regions[index].prevPhysical].nextPhysical = before;
+        }
+        regions[index].prevPhysical = before;
+        regions[index].offset += padding;
+        regions[index].size -= padding;
+        insertFree(before);
+    }
+
+    if (regions[index].size > size)
+    {
+        uint32_t after = createRegion(regions[index].offset + size, regions[index].size - size);
+        regions[after].prevPhysical = index;
+        regions[after].nextPhysical = regions[index].nextPhysical;
+        if (regions[index].nextPhysical != NO_REGION)
+        {
+            regions[regions[index].nextPhysical].prevPhysical = after;
+        }
+        regions[index].nextPhysical = after;
+        regions[index].size = size;
+        insertFree(after);
+    }
+
+    usedBytes += size;
+    offset = regions[index].offset;
+    regionIndex = index;
+    return true;
+}
+
+VkDeviceSize MemoryBlock::free(uint32_t index)
+{
+    VkDeviceSize releasedSize = regions[index].size;
+    usedBytes -= releasedSize;
+
+    // merge with free physical neighbours
+    uint32_t next = regions[index].nextPhysical;
+    if (next != NO_REGION && regions[next].free)
+    {
+        removeFree(next);
+        regions[index].size += regions[next].size;
+        regions[index].nextPhysical = regions[next].nextPhysical;
+        if (regions[next].nextPhysical != NO_REGION)
+        {
+            regions[regions[next].nextPhysical].prevPhysical = index;
+        }
+        releaseRegion(next);
+    }
+
+    uint32_t prev = regions[index].prevPhysical;
+    if (prev != NO_REGION && regions[prev].free)
+    {
+        removeFree(prev);
+        regions[prev].size += regions[index].size;
+        regions[prev].nextPhysical = regions[index].nextPhysical;
+        if (regions[index].nextPhysical != NO_REGION)
+        {
+            regions[regions[index].nextPhysical].prevPhysical = prev;
+        }
+        releaseRegion(index);
+        index = prev;
+    }
+
+    insertFree(index);
+    return releasedSize;
+}
+
+VkDeviceSize MemoryBlock::largestFreeRegion() const
+{
+    if (flBitmap == 0)
+    {
+        return 0;
+    }
+
+    // the highest non-empty list holds the largest regions, its members differ by less than one step
+    uint32_t fl = floorLog2(flBitmap);
+    uint32_t sl = floorLog2(slBitmaps[fl]);
+    VkDeviceSize largest = 0;
+    for (uint32_t index = freeHeads[fl][sl]; index != NO_REGION; index = regions[index].nextFree)
+    {
+        largest = std::max(largest, regions[index].size);
+    }
+    return largest;
+}
+
+MemoryAllocator::MemoryAllocator() = default;
+
+MemoryAllocator::~MemoryAllocator() = default;
+
+void MemoryAllocator::init(VkPhysicalDevice physicalDevice, VkDevice device)
+{
+    this->device = device;
+    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+
+    VkPhysicalDeviceProperties deviceProperties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+    bufferImageGranularity = deviceProperties.limits.bufferImageGranularity;
+    maxAllocationCount = deviceProperties.limits.maxMemoryAllocationCount;
+
+    pools.clear();
+    pools.resize(memoryProperties.memoryTypeCount * 2);
+    for (uint32_t i = 0; i < pools.size(); ++i)
+    {
+        uint32_t memoryType = i / 2;
+        VkDeviceSize heapSize = memoryProperties.memoryHeaps[memoryProperties.memoryTypes[memoryType].heapIndex].size;
+
+        pools[i].memoryType = memoryType;
+        pools[i].blockSize = heapSize <= SMALL_HEAP_SIZE ? alignUp(heapSize / 8, MIN_ALIGNMENT) : DEFAULT_BLOCK_SIZE;
+    }
+}
+
+void MemoryAllocator::cleanup()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto& pool : pools)
+    {
+        for (auto& block : pool.blocks)
+        {
+            if (block)
+            {
+                freeDeviceMemory(block->memory, block->size, block->mapped != nullptr);
+            }
+        }
+        pool.blocks.clear();
+    }
+}
+
+uint32_t MemoryAllocator::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const
+{
+    for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; ++i)
+    {
+        if ((typeFilter & (1 << i)) && (memoryProperties.memoryTypes[i].propertyFlags & properties) == properties)
+        {
+            return i;
+        }
+    }
+
+    throw std::runtime_error("failed to find suitable memory type!");
+}
+
+VkDeviceMemory MemoryAllocator::allocateDeviceMemory(uint32_t memoryType, VkDeviceSize size, void** mapped)
+{
+    if (deviceAllocationCount >= maxAllocationCount)
+    {
+        throw std::runtime_error("too many device memory allocations!");
+    }
+
+    VkMemoryAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = size;
+    allocInfo.memoryTypeIndex = memoryType;
+
+    VkDeviceMemory memory;
+    if (vkAllocateMemory(device, &allocInfo, nullptr, &memory) != VK_SUCCESS)
+    {
+        return VK_NULL_HANDLE;
+    }
+    ++deviceAllocationCount;
+
+    *mapped = nullptr;
+    if (memoryProperties.memoryTypes[memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+    {
+        vkMapMemory(device, memory, 0, VK_WHOLE_SIZE, 0, mapped);
+    }
+    return memory;
+}
+
+void MemoryAllocator::freeDeviceMemory(VkDeviceMemory memory, VkDeviceSize, bool mapped)
+{
+    if (mapped)
+    {
+        vkUnmapMemory(device, memory);
+    }
+    vkFreeMemory(device, memory, nullptr);
+    --deviceAllocationCount;
+}
+
+MemoryAllocation MemoryAllocator::allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, ResourceKind kind)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    uint32_t memoryType = findMemoryType(requirements.memoryTypeBits, properties);
+    // with a granularity of one, linear and optimal resources may share pages
+    bool separateOptimal = bufferImageGranularity > 1 && kind == ResourceKind::Optimal;
+    uint32_t poolIndex = memoryType * 2 + (separateOptimal ? 1 : 0);
+    Pool& pool = pools[poolIndex];
+
+    MemoryAllocation allocation{};
+    allocation.size = requirements.size;
+
+    // large resources get their own memory, they would only fragment the blocks
+    if (requirements.size <= pool.blockSize / 2)
+    {
+        auto tryBlock = [&](uint32_t blockIndex)
+        {
+            MemoryBlock& block = *pool.blocks[blockIndex];
+            if (!block.allocate(requirements.size, requirements.alignment, allocation.offset, allocation.region))
+            {
+                return false;
+            }
+            allocation.memory = block.memory;
+            allocation.mapped = block.mapped ? static_cast<uint8_t*>(block.mapped) + allocation.offset : nullptr;
+            allocation.pool = poolIndex;
+            allocation.block = blockIndex;
+            return true;
+        };
+
+        bool allocated = false;
+        for (uint32_t i = 0; i < pool.blocks.size() && !allocated; ++i)
+        {
+            allocated = pool.blocks[i] && tryBlock(i);
+        }
+
+        if (!allocated)
+        {
+            void* mapped;
+            VkDeviceMemory memory = allocateDeviceMemory(memoryType, pool.blockSize, &mapped);
+            if (memory != VK_NULL_HANDLE)
+            {
+                auto freeSlot = std::find(pool.blocks.begin(), pool.blocks.end(), nullptr);
+                if (freeSlot == pool.blocks.end())
+                {
+                    freeSlot = pool.blocks.insert(pool.blocks.end(), nullptr);
+                }
+                *freeSlot = std::make_unique<MemoryBlock>(memory, pool.blockSize, mapped);
+                allocated = tryBlock(static_cast<uint32_t>(freeSlot - pool.blocks.begin()));
+            }
+        }
+
+        if (allocated)
+        {
+            ++allocationCount;
+            usedBytes += allocation.size;
+            peakUsedBytes = std::max(peakUsedBytes, usedBytes);
+            return allocation;
+        }
+    }
+
+    // also the last resort when no new block fits into the heap
+    void* mapped;
+    allocation.memory = allocateDeviceMemory(memoryType, requirements.size, &mapped);
+    if (allocation.memory == VK_NULL_HANDLE)
+    {
+        throw std::runtime_error("failed to allocate device memory!");
+    }
+    allocation.offset = 0;
+    allocation.mapped = mapped;
+    allocation.pool = DEDICATED_POOL;
+
+    ++dedicatedCount;
+    ++allocationCount;
+    usedBytes += allocation.size;
+    peakUsedBytes = std::max(peakUsedBytes, usedBytes);
+    return allocation;
+}
+
+void MemoryAllocator::free(MemoryAllocation& allocation)
+{
+    if (allocation.memory == VK_NULL_HANDLE)
+    {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (allocation.pool == DEDICATED_POOL)
+    {
+        freeDeviceMemory(allocation.memory, allocation.size, allocation.mapped != nullptr);
+        --dedicatedCount;
+    }
+    else
+    {
+        Pool& pool = pools[allocation.pool];
+        pool.blocks[allocation.block]->free(allocation.region);
+
+        // one empty block per pool is kept around for short-lived resources such as staging buffers
+        if (pool.blocks[allocation.block]->isEmpty())
+        {
+            bool otherEmpty = false;
+            for (uint32_t i = 0; i < pool.blocks.size(); ++i)
+            {
+                otherEmpty = otherEmpty || (i != allocation.block && pool.blocks[i] && pool.blocks[i]->isEmpty());
+            }
+            if (otherEmpty)
+            {
+                MemoryBlock& block = *pool.blocks[allocation.block];
+                freeDeviceMemory(block.memory, block.size, block.mapped != nullptr);
+                pool.blocks[allocation.block].reset();
+            }
+        }
+    }
+
+    --allocationCount;
+    usedBytes -= allocation.size;
+    allocation = {};
+}
+
+MemoryStats MemoryAllocator::getStats()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    MemoryStats stats{};
+    stats.dedicatedCount = dedicatedCount;
+    stats.allocationCount = allocationCount;
+    stats.usedBytes = usedBytes;
+    stats.peakUsedBytes = peakUsedBytes;
+
+    VkDeviceSize freeBytes = 0;
+    VkDeviceSize largestFreeBytes = 0;
+    for (const auto& pool : pools)
+    {
+        for (const auto& block : pool.blocks)
+        {
+            if (!block)
+            {
+                continue;
+            }
+            ++stats.blockCount;
+            stats.blockBytes += block->size;
+            freeBytes += block->size - block->usedBytes;
+            largestFreeBytes += block->largestFreeRegion();
+        }
+    }
+
+    stats.fragmentation = freeBytes > 0 ? 1.f - static_cast<float>(largestFreeBytes) / freeBytes : 0.f;
+    return stats;
+}
\ No newline at end of file
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <cstdint>
+
+// a range of device memory handed out by MemoryAllocator
+struct MemoryAllocation
+{
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    VkDeviceSize offset = 0;
+    VkDeviceSize size = 0;
+    // host-visible memory stays mapped for the lifetime of its block
+    void* mapped = nullptr;
+    uint32_t pool = 0;
+    uint32_t block = 0;
+    uint32_t region = 0;
+};
+
+// buffers and linear images share pages, optimal images are kept apart when bufferImageGranularity requires it
+enum class ResourceKind
+{
+    Linear,
+    Optimal
+};
+
+struct MemoryStats
+{
+    uint32_t blockCount = 0;
+    uint32_t dedicatedCount = 0;
+    uint32_t allocationCount = 0;
+    VkDeviceSize blockBytes = 0;
+    VkDeviceSize usedBytes = 0;
+    VkDeviceSize peakUsedBytes = 0;
+    // share of the free space in blocks that is not part of their largest free region
+    float fragmentation = 0.f;
+};
+
+class MemoryBlock;
+
+// sub-allocates resources from large blocks per memory type with a two-level segregated fit (tlsf) scheme
+class MemoryAllocator
+{
+public:
+    MemoryAllocator();
+    MemoryAllocator(const MemoryAllocator&) = delete;
+    MemoryAllocator& operator=(const MemoryAllocator&) = delete;
+    ~MemoryAllocator();
+
+    void init(VkPhysicalDevice physicalDevice, VkDevice device);
+    // frees every block, all allocations must have been released
+    void cleanup();
+
+    MemoryAllocation allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, ResourceKind kind);
+    // no-op for empty allocations
+    void free(MemoryAllocation& allocation);
+
+    MemoryStats getStats();
+
+private:
+    struct Pool
+    {
+        uint32_t memoryType;
+        VkDeviceSize blockSize;
+        std::vector<std::unique_ptr<MemoryBlock>> blocks;
+    };
+
+    uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const;
+    VkDeviceMemory allocateDeviceMemory(uint32_t memoryType, VkDeviceSize size, void** mapped);
+    void freeDeviceMemory(VkDeviceMemory memory, VkDeviceSize size, bool mapped);
+
+    VkDevice device = VK_NULL_HANDLE;
+    VkPhysicalDeviceMemoryProperties memoryProperties{};
+    VkDeviceSize bufferImageGranularity = 1;
+    uint32_t maxAllocationCount = 0;
+
+    // one pool per memory type and resource kind
+    std::vector<Pool> pools;
+    std::mutex mutex;
+
+    uint32_t deviceAllocationCount = 0;
+    uint32_t dedicatedCount = 0;
+    uint32_t allocationCount = 0;
+    VkDeviceSize usedBytes = 0;
+    VkDeviceSize peakUsedBytes = 0;
+};
\ No newline at end of file
@@ -0,0 +1,164 @@
+#include "mesh_cache.hpp"
+
+#include <cstring>
+
+static const char MESH_CACHE_MAGIC[4] = {'V', 'K', 'M', 'C'};
+static const uint64_t MESH_CACHE_ALIGNMENT = 16;
+
+static uint64_t alignOffset(uint64_t offset)
+{
+    return (offset + MESH_CACHE_ALIGNMENT - 1) & ~(MESH_CACHE_ALIGNMENT - 1);
+}
+
+static const uint64_t FNV_OFFSET_BASIS = 14695981039346656037ull;
+
+// 64-bit FNV-1a
+static uint64_t hashBytes(const uint8_t* data, size_t size, uint64_t hash = FNV_OFFSET_BASIS)
+{
+    for (size_t i = 0; i < size; ++i)
+    {
+        hash ^= data[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+uint64_t MeshCache::hashFile(const std::string& path)
+{
+    MappedFile source;
+    if (!source.open(path))
+    {
+        return 0;
+    }
+    return hashBytes(source.data(), source.size());
+}
+
+uint64_t MeshCache::hashOptions(const MeshProcessOptions& options)
+{
+    // field by field, the struct itself may contain padding
+    uint64_t hash = FNV_OFFSET_BASIS;
+    uint8_t weld = options.weld ? 1 : 0;
+    hash = hashBytes(&weld, sizeof(weld), hash);
+    hash = hashBytes(reinterpret_cast<const uint8_t*>(&options.weldEpsilon), sizeof(options.weldEpsilon), hash);
+    uint8_t optimizeIndices = options.optimizeIndices ? 1 : 0;
+    hash = hashBytes(&optimizeIndices, sizeof(optimizeIndices), hash);
+    uint32_t vertexFormat = static_cast<uint32_t>(options.vertexFormat);
+    hash = hashBytes(reinterpret_cast<const uint8_t*>(&vertexFormat), sizeof(vertexFormat), hash);
+    uint8_t buildMeshlets = options.buildMeshlets ? 1 : 0;
+    hash = hashBytes(&buildMeshlets, sizeof(buildMeshlets), hash);
+    hash = hashBytes(reinterpret_cast<const uint8_t*>(&options.lodLevels), sizeof(options.lodLevels), hash);
+    return hash;
+}
+
+bool MeshCache::open(const std::string& path, const MeshCacheKey& key)
+{
+    close();
+
+    if (!file.open(path) || file.size() < sizeof(MeshCacheHeader))
+    {
+        file.close();
+        return false;
+    }
+
+    auto cacheHeader = reinterpret_cast<const MeshCacheHeader*>(file.data());
+
+    bool valid = memcmp(cacheHeader->magic, MESH_CACHE_MAGIC, sizeof(MESH_CACHE_MAGIC)) == 0 &&
+        cacheHeader->version == MESH_CACHE_VERSION &&
+        cacheHeader->sourceHash == key.sourceHash &&
+        cacheHeader->processHash == key.processHash &&
+        cacheHeader->importFlags == key.importFlags &&
+        cacheHeader->vertexFormat == static_cast<uint32_t>(key.vertexFormat) &&
+        cacheHeader->vertexStride == vertexStride(key.vertexFormat) &&
+        cacheHeader->meshCount > 0 &&
+        cacheHeader->rangesOffset + cacheHeader->meshCount * sizeof(MeshRange) <= file.size() &&
+        cacheHeader->verticesOffset + uint64_t(cacheHeader->vertexCount) * cacheHeader->vertexStride <= file.size() &&
+        cacheHeader->indices16Offset + cacheHeader->index16Count * sizeof(uint16_t) <= file.size() &&
+        cacheHeader->indices32Offset + cacheHeader->index32Count * sizeof(uint32_t) <= file.size() &&
+        cacheHeader->meshletsOffset + cacheHeader->meshletCount * sizeof(Meshlet) <= file.size();
+
+    if (!valid)
+    {
+        file.close();
+        return false;
+    }
+
+    header = cacheHeader;
+    return true;
+}
+
+void MeshCache::close()
+{
+    header = nullptr;
+    file.close();
+}
+
+const MeshRange* MeshCache::ranges() const
+{
+    return reinterpret_cast<const MeshRange*>(file.data() + header->rangesOffset);
+}
+
+GeometryView MeshCache::view() const
+{
+    GeometryView geometryView{};
+    geometryView.vertexFormat = static_cast<VertexFormat>(header->vertexFormat);
+    geometryView.vertices = file.data() + header->verticesOffset;
+    geometryView.vertexCount = header->vertexCount;
+    geometryView.indices16 = reinterpret_cast<const uint16_t*>(file.data() + header->indices16Offset);
+    geometryView.index16Count = header->index16Count;
+    geometryView.indices32 = reinterpret_cast<const uint32_t*>(file.data() + header->indices32Offset);
+    geometryView.index32Count = header->index32Count;
+    geometryView.meshlets = reinterpret_cast<const Meshlet*>(file.data() + header->meshletsOffset);
+    geometryView.meshletCount = header->meshletCount;
+    return geometryView;
+}
+
+bool MeshCache::write(const std::string& path, const MeshCacheKey& key, const PackedGeometry& geometry)
+{
+    if (geometry.ranges.empty())
+    {
+        return false;
+    }
+
+    GeometryView geometryView = geometry.view();
+    uint64_t stride = vertexStride(geometryView.vertexFormat);
+
+    MeshCacheHeader cacheHeader{};
+    memcpy(cacheHeader.magic, MESH_CACHE_MAGIC, sizeof(MESH_CACHE_MAGIC));
+    cacheHeader.version = MESH_CACHE_VERSION;
+    cacheHeader.sourceHash = key.sourceHash;
+    cacheHeader.processHash = key.processHash;
+    cacheHeader.importFlags = key.importFlags;
+    cacheHeader.vertexFormat = static_cast<uint32_t>(geometryView.vertexFormat);
+    cacheHeader.vertexStride = static_cast<uint32_t>(stride);
+    cacheHeader.meshCount = static_cast<uint32_t>(geometry.ranges.size());
+    cacheHeader.vertexCount = geometryView.vertexCount;
+    cacheHeader.index16Count = geometryView.index16Count;
+    cacheHeader.index32Count = geometryView.index32Count;
+    cacheHeader.meshletCount = geometryView.meshletCount;
+    cacheHeader.rangesOffset = alignOffset(sizeof(MeshCacheHeader));
+    cacheHeader.verticesOffset = alignOffset(cacheHeader.rangesOffset + geometry.ranges.size() * sizeof(MeshRange));
+    cacheHeader.indices16Offset = alignOffset(cacheHeader.verticesOffset + geometryView.vertexCount * stride);
+    cacheHeader.indices32Offset = alignOffset(cacheHeader.indices16Offset + geometryView.index16Count * sizeof(uint16_t));
+    cacheHeader.meshletsOffset = alignOffset(cacheHeader.indices32Offset + geometryView.index32Count * sizeof(uint32_t));
+
+    // laid out in memory first, the padding between the sections stays zeroed
+    uint64_t fileSize = cacheHeader.meshletsOffset + geometryView.meshletCount * sizeof(Meshlet);
+    std::vector<uint8_t> file(fileSize, 0);
+    // empty sections may come with null pointers
+    auto place = [&](uint64_t offset, const void* data, uint64_t size)
+    {
+        if (size > 0)
+        {
+            memcpy(file.data() + offset, data, size);
+        }
+    };
+
+    place(0, &cacheHeader, sizeof(cacheHeader));
+    place(cacheHeader.rangesOffset, geometry.ranges.data(), geometry.ranges.size() * sizeof(MeshRange));
+    place(cacheHeader.verticesOffset, geometryView.vertices, geometryView.vertexCount * stride);
+    place(cacheHeader.indices16Offset, geometryView.indices16, geometryView.index16Count * sizeof(uint16_t));
+    place(cacheHeader.indices32Offset, geometryView.indices32, geometryView.index32Count * sizeof(uint32_t));
+    place(cacheHeader.meshletsOffset, geometryView.meshlets, geometryView.meshletCount * sizeof(Meshlet));
+
+    return writeFileAtomically(path, file.data(), file.size());
+}
\ No newline at end of file
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include "mapped_file.hpp"
+#include "packed_geometry.hpp"
+#include "app_options.hpp"
+
+// bump whenever the layout of the cache, of MeshRange or of a vertex format changes
+const uint32_t MESH_CACHE_VERSION = 5;
+
+// everything the processed geometry depends on
+struct MeshCacheKey
+{
+    uint64_t sourceHash;
+    uint64_t processHash;
+    uint32_t importFlags;
+    VertexFormat vertexFormat;
+};
+
+struct MeshCacheHeader
+{
+    char magic[4];
+    uint32_t version;
+    uint64_t sourceHash;
+    uint64_t processHash;
+    uint32_t importFlags;
+    uint32_t vertexFormat;
+    uint32_t vertexStride;
+    uint32_t meshCount;
+    uint32_t vertexCount;
+    uint32_t index16Count;
+    uint32_t index32Count;
+    uint32_t meshletCount;
+    uint64_t rangesOffset;
+    uint64_t verticesOffset;
+    uint64_t indices16Offset;
+    uint64_t indices32Offset;
+    uint64_t meshletsOffset;
+};
+
+// on-disk binary copy of the processed meshes of a model,
+// read back through a memory mapping so nothing is parsed on warm starts
+class MeshCache
+{
+public:
+    bool open(const std::string& path, const MeshCacheKey& key);
+    void close();
+
+    bool isOpen() const { return header != nullptr; }
+    uint32_t meshCount() const { return header->meshCount; }
+    const MeshRange* ranges() const;
+    GeometryView view() const;
+
+    static bool write(const std::string& path, const MeshCacheKey& key, const PackedGeometry& geometry);
+    static uint64_t hashFile(const std::string& path);
+    static uint64_t hashOptions(const MeshProcessOptions& options);
+
+private:
+    MappedFile file;
+    const MeshCacheHeader* header = nullptr;
+};
\ No newline at end of file
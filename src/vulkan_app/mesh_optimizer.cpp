@@ -0,0 +1,284 @@
+#include "mesh_optimizer.hpp"
+
+#include <algorithm>
+#include <numeric>
+
+VertexCacheStats analyzeVertexCache(const std::vector<uint32_t>& indices, uint32_t vertexCount, uint32_t cacheSize)
+{
+    // zeroed for meshes without a whole triangle, the ratios would divide by zero
+    VertexCacheStats stats{};
+    if (indices.size() < 3 || vertexCount == 0)
+    {
+        return stats;
+    }
+
+    // a vertex is cached while fewer than cacheSize misses happened since it was loaded
+    std::vector<uint32_t> loadTime(vertexCount, 0);
+    std::vector<bool> referenced(vertexCount, false);
+    uint32_t timestamp = cacheSize + 1;
+    uint32_t misses = 0;
+    uint32_t uniqueVertices = 0;
+
+    for (uint32_t index : indices)
+    {
+        if (timestamp - loadTime[index] > cacheSize)
+        {
+            loadTime[index] = timestamp++;
+            ++misses;
+        }
+
+        if (!referenced[index])
+        {
+            referenced[index] = true;
+            ++uniqueVertices;
+        }
+    }
+
+    stats.acmr = static_cast<float>(misses) / static_cast<float>(indices.size() / 3);
+    stats.atvr = static_cast<float>(misses) / static_cast<float>(uniqueVertices);
+    return stats;
+}
+
+void optimizeVertexCache(std::vector<uint32_t>& indices, uint32_t vertexCount, std::vector<uint32_t>* clusters, uint32_t cacheSize)
+{
+    size_t triangleCount = indices.size() / 3;
+
+    if (clusters)
+    {
+        clusters->clear();
+    }
+
+    if (triangleCount == 0)
+    {
+        return;
+    }
+
+    // vertex -> triangle adjacency
+    std::vector<uint32_t> liveTriangles(vertexCount, 0);
+    for (uint32_t index : indices)
+    {
+        ++liveTriangles[index];
+    }
+
+    std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+    for (uint32_t v = 0; v < vertexCount; ++v)
+    {
+        adjacencyOffsets[v + 1] = adjacencyOffsets[v] + liveTriangles[v];
+    }
+
+    std::vector<uint32_t> adjacency(indices.size());
+    std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+    for (uint32_t t = 0; t < triangleCount; ++t)
+    {
+        for (uint32_t k = 0; k < 3; ++k)
+        {
+            adjacency[fill[indices[t * 3 + k]]++] = t;
+        }
+    }
+
+    std::vector<uint32_t> cacheTime(vertexCount, 0);
+    std::vector<bool> emitted(triangleCount, false);
+    std::vector<uint32_t> deadEnds;
+    std::vector<uint32_t> candidates;
+    std::vector<uint32_t> output;
+    output.reserve(indices.size());
+
+    uint32_t timestamp = cacheSize + 1;
+    uint32_t cursor = 0;
+
+    // falls back to the most recent vertex with work left, then scans the mesh in order
+    auto skipDeadEnd = [&]() -> int64_t
+    {
+        while (!deadEnds.empty())
+        {
+            uint32_t vertex = deadEnds.back();
+            deadEnds.pop_back();
+            if (liveTriangles[vertex] > 0)
+            {
+                return vertex;
+            }
+        }
+
+        while (cursor < vertexCount)
+        {
+            if (liveTriangles[cursor] > 0)
+            {
+                return cursor;
+            }
+            ++cursor;
+        }
+
+        return -1;
+    };
+
+    int64_t fanning = -1;
+    bool deadEnd = true;
+
+    while (true)
+    {
+        if (deadEnd)
+        {
+            fanning = skipDeadEnd();
+            if (fanning < 0)
+            {
+                break;
+            }
+
+            // the cache holds little of use after a dead end, so a new cluster starts here
+            if (clusters)
+            {
+                clusters->push_back(static_cast<uint32_t>(output.size() / 3));
+            }
+        }
+
+        candidates.clear();
+
+        for (uint32_t a = adjacencyOffsets[fanning]; a < adjacencyOffsets[fanning + 1]; ++a)
+        {
+            uint32_t t = adjacency[a];
+            if (emitted[t])
+            {
+                continue;
+            }
+
+            for (uint32_t k = 0; k < 3; ++k)
+            {
+                uint32_t v = indices[t * 3 + k];
+                output.push_back(v);
+                deadEnds.push_back(v);
+                candidates.push_back(v);
+                --liveTriangles[v];
+
+                if (timestamp - cacheTime[v] > cacheSize)
+                {
+                    cacheTime[v] = timestamp++;
+                }
+            }
+            emitted[t] = true;
+        }
+
+        // prefer the candidate that is still cached after fanning all its remaining triangles,
+        // and among those the one that entered the cache first
+        int64_t next = -1;
+        int64_t bestPriority = -1;
+        for (uint32_t v : candidates)
+        {
+            if (liveTriangles[v] == 0)
+            {
+                continue;
+            }
+
+            int64_t priority = 0;
+            if (timestamp - cacheTime[v] + 2 * liveTriangles[v] <= cacheSize)
+            {
+                priority = timestamp - cacheTime[v];
+            }
+
+            if (priority > bestPriority)
+            {
+                bestPriority = priority;
+                next = v;
+            }
+        }
+
+        fanning = next;
+        deadEnd = next < 0;
+    }
+
+    indices.swap(output);
+}
+
+void optimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<Vertex>& vertices, const std::vector<uint32_t>& clusters)
+{
+    size_t triangleCount = indices.size() / 3;
+    if (clusters.size() < 2 || triangleCount == 0)
+    {
+        return;
+    }
+
+    // area weighted centroid of the whole mesh
+    glm::vec3 meshCentroid(0.f);
+    float meshArea = 0.f;
+    for (size_t t = 0; t < triangleCount; ++t)
+    {
+        const glm::vec3& a = vertices[indices[t * 3 + 0]].pos;
+        const glm::vec3& b = vertices[indices[t * 3 + 1]].pos;
+        const glm::vec3& c = vertices[indices[t * 3 + 2]].pos;
+
+        float area = glm::length(glm::cross(b - a, c - a));
+        meshCentroid += (a + b + c) * (area / 3.f);
+        meshArea += area;
+    }
+    if (meshArea > 0.f)
+    {
+        meshCentroid /= meshArea;
+    }
+
+    std::vector<float> sortKeys(clusters.size());
+    for (size_t i = 0; i < clusters.size(); ++i)
+    {
+        size_t begin = clusters[i];
+        size_t end = i + 1 < clusters.size() ? clusters[i + 1] : triangleCount;
+
+        glm::vec3 centroid(0.f);
+        glm::vec3 normal(0.f);
+        float area = 0.f;
+
+        for (size_t t = begin; t < end; ++t)
+        {
+            const glm::vec3& a = vertices[indices[t * 3 + 0]].pos;
+            const glm::vec3& b = vertices[indices[t * 3 + 1]].pos;
+            const glm::vec3& c = vertices[indices[t * 3 + 2]].pos;
+
+            glm::vec3 weightedNormal = glm::cross(b - a, c - a);
+            float triangleArea = glm::length(weightedNormal);
+
+            centroid += (a + b + c) * (triangleArea / 3.f);
+            normal += weightedNormal;
+            area += triangleArea;
+        }
+
+        float normalLength = glm::length(normal);
+        if (area <= 0.f || normalLength <= 0.f)
+        {
+            sortKeys[i] = 0.f;
+            continue;
+        }
+
+        sortKeys[i] = glm::dot(centroid / area - meshCentroid, normal / normalLength);
+    }
+
+    std::vector<uint32_t> order(clusters.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return sortKeys[a] > sortKeys[b]; });
+
+    std::vector<uint32_t> output;
+    output.reserve(indices.size());
+    for (uint32_t cluster : order)
+    {
+        size_t begin = clusters[cluster];
+        size_t end = cluster + 1 < clusters.size() ? clusters[cluster + 1] : triangleCount;
+        output.insert(output.end(), indices.begin() + begin * 3, indices.begin() + end * 3);
+    }
+
+    indices.swap(output);
+}
+
+void optimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+{
+    std::vector<uint32_t> remap(vertices.size(), UINT32_MAX);
+    std::vector<Vertex> reordered;
+    reordered.reserve(vertices.size());
+
+    for (auto& index : indices)
+    {
+        if (remap[index] == UINT32_MAX)
+        {
+            remap[index] = static_cast<uint32_t>(reordered.size());
+            reordered.push_back(vertices[index]);
+        }
+        index = remap[index];
+    }
+
+    vertices.swap(reordered);
+}
\ No newline at end of file
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include "vertex_data.hpp"
+
+// FIFO size the optimizer targets and the statistics are measured with
+const uint32_t VERTEX_CACHE_SIZE = 16;
+
+struct VertexCacheStats
+{
+    // vertex shader invocations per triangle
+    float acmr = 0.f;
+    // vertex shader invocations per referenced vertex
+    float atvr = 0.f;
+};
+
+VertexCacheStats analyzeVertexCache(const std::vector<uint32_t>& indices, uint32_t vertexCount, uint32_t cacheSize = VERTEX_CACHE_SIZE);
+
+// Tipsify triangle reordering; clusters receives the first triangle of every run
+// that starts at a dead end, such runs can be reordered by optimizeOverdraw at little cache cost
+void optimizeVertexCache(std::vector<uint32_t>& indices, uint32_t vertexCount, std::vector<uint32_t>* clusters = nullptr, uint32_t cacheSize = VERTEX_CACHE_SIZE);
+
+// draws outward facing clusters first, so they occlude the rest of the mesh
+void optimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<Vertex>& vertices, const std::vector<uint32_t>& clusters);
+
+// stores vertices in the order they are first referenced and drops unreferenced ones
+void optimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices);
\ No newline at end of file
@@ -0,0 +1,317 @@
+#include "mesh_simplifier.hpp"
+#include "mesh_optimizer.hpp"
+
+#include <algorithm>
+#include <numeric>
+#include <cmath>
+
+// a level has to drop at least this fraction of the previous level's triangles to be kept
+static const float MIN_LOD_REDUCTION = 0.1f;
+// smallest normalized dot product between a triangle's normal before and after a collapse
+static const float MAX_NORMAL_CHANGE = 0.25f;
+
+// symmetric 4x4 matrix summing squared distances to a set of planes
+struct Quadric
+{
+    double a00, a01, a02, a03;
+    double a11, a12, a13;
+    double a22, a23;
+    double a33;
+
+    void addPlane(const glm::vec3& normal, float distance)
+    {
+        double x = normal.x, y = normal.y, z = normal.z, w = distance;
+        a00 += x * x; a01 += x * y; a02 += x * z; a03 += x * w;
+        a11 += y * y; a12 += y * z; a13 += y * w;
+        a22 += z * z; a23 += z * w;
+        a33 += w * w;
+    }
+
+    void add(const Quadric& other)
+    {
+        a00 += other.a00; a01 += other.a01; a02 += other.a02; a03 += other.a03;
+        a11 += other.a11; a12 += other.a12; a13 += other.a13;
+        a22 += other.a22; a23 += other.a23;
+        a33 += other.a33;
+    }
+
+    double evaluate(const glm::vec3& p) const
+    {
+        double x = p.x, y = p.y, z = p.z;
+        double result = a00 * x * x + 2 * a01 * x * y + 2 * a02 * x * z + 2 * a03 * x +
+            a11 * y * y + 2 * a12 * y * z + 2 * a13 * y +
+            a22 * z * z + 2 * a23 * z +
+            a33;
+        return std::max(result, 0.0);
+    }
+};
+
+struct Collapse
+{
+    uint32_t from;
+    uint32_t to;
+    double cost;
+};
+
+// vertices that must not move: on a border edge or sharing their position with another vertex
+static std::vector<bool> findLockedVertices(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices)
+{
+    std::vector<bool> locked(vertices.size(), false);
+
+    std::vector<uint32_t> order(vertices.size());
+    std::iota(order.begin(), order.end(), 0);
+    auto positionLess = [&](uint32_t a, uint32_t b)
+    {
+        const glm::vec3& pa = vertices[a].pos;
+        const glm::vec3& pb = vertices[b].pos;
+        if (pa.x != pb.x) return pa.x < pb.x;
+        if (pa.y != pb.y) return pa.y < pb.y;
+        return pa.z < pb.z;
+    };
+    std::sort(order.begin(), order.end(), positionLess);
+    for (size_t i = 1; i < order.size(); ++i)
+    {
+        if (!positionLess(order[i - 1], order[i]))
+        {
+            locked[order[i - 1]] = true;
+            locked[order[i]] = true;
+        }
+    }
+
+    // an edge seen once is on the border, seen in both directions it is interior
+    std::vector<uint64_t> edges;
+    edges.reserve(indices.size());
+    for (size_t i = 0; i + 2 < indices.size(); i += 3)
+    {
+        for (int k = 0; k < 3; ++k)
+        {
+            uint32_t a = indices[i + k];
+            uint32_t b = indices[i + (k + 1) % 3];
+            edges.push_back((static_cast<uint64_t>(std::min(a, b)) << 32) | std::max(a, b));
+        }
+    }
+    std::sort(edges.begin(), edges.end());
+    for (size_t i = 0; i < edges.size();)
+    {
+        size_t j = i;
+        while (j < edges.size() && edges[j] == edges[i])
+        {
+            ++j;
+        }
+        if (j - i == 1)
+        {
+            locked[edges[i] >> 32] = true;
+            locked[edges[i] & UINT32_MAX] = true;
+        }
+        i = j;
+    }
+
+    return locked;
+}
+
+// whether moving from onto to keeps every other triangle around from facing the same way
+static bool keepsOrientation(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices,
+    const std::vector<uint32_t>& triangles, uint32_t from, uint32_t to)
+{
+    for (uint32_t triangle : triangles)
+    {
+        const uint32_t* corners = &indices[triangle * 3];
+        if (corners[0] == to || corners[1] == to || corners[2] == to)
+        {
+            // collapses away
+            continue;
+        }
+
+        glm::vec3 p[3];
+        glm::vec3 q[3];
+        for (int k = 0; k < 3; ++k)
+        {
+            p[k] = vertices[corners[k]].pos;
+            q[k] = corners[k] == from ? vertices[to].pos : p[k];
+        }
+
+        glm::vec3 before = glm::cross(p[1] - p[0], p[2] - p[0]);
+        glm::vec3 after = glm::cross(q[1] - q[0], q[2] - q[0]);
+        float lengths = glm::length(before) * glm::length(after);
+        if (lengths <= 0.f || glm::dot(before, after) < MAX_NORMAL_CHANGE * lengths)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::vector<uint32_t> simplifyMesh(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, size_t targetIndexCount, float* resultError)
+{
+    std::vector<uint32_t> result = indices;
+    double maxCost = 0.0;
+
+    std::vector<Quadric> quadrics(vertices.size(), Quadric{});
+    for (size_t i = 0; i + 2 < indices.size(); i += 3)
+    {
+        const glm::vec3& p0 = vertices[indices[i + 0]].pos;
+        const glm::vec3& p1 = vertices[indices[i + 1]].pos;
+        const glm::vec3& p2 = vertices[indices[i + 2]].pos;
+
+        glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+        float area = glm::length(normal);
+        if (area <= 0.f)
+        {
+            continue;
+        }
+        normal = normal / area;
+        float distance = -glm::dot(normal, p0);
+        for (int k = 0; k < 3; ++k)
+        {
+            quadrics[indices[i + k]].addPlane(normal, distance);
+        }
+    }
+
+    std::vector<bool> locked = findLockedVertices(vertices, indices);
+
+    std::vector<uint32_t> remap(vertices.size());
+    std::vector<bool> touched(vertices.size());
+    std::vector<uint32_t> triangleOffsets(vertices.size() + 1);
+    std::vector<uint32_t> vertexTriangles;
+    std::vector<Collapse> collapses;
+
+    // every pass collapses a set of independent edges, cheapest first
+    while (result.size() > targetIndexCount)
+    {
+        uint32_t triangleCount = static_cast<uint32_t>(result.size() / 3);
+
+        std::fill(triangleOffsets.begin(), triangleOffsets.end(), 0);
+        for (uint32_t index : result)
+        {
+            ++triangleOffsets[index + 1];
+        }
+        std::partial_sum(triangleOffsets.begin(), triangleOffsets.end(), triangleOffsets.begin());
+        vertexTriangles.resize(result.size());
+        {
+            std::vector<uint32_t> cursor(triangleOffsets.begin(), triangleOffsets.end() - 1);
+            for (uint32_t i = 0; i < result.size(); ++i)
+            {
+                vertexTriangles[cursor[result[i]]++] = i / 3;
+            }
+        }
+
+        collapses.clear();
+        for (uint32_t i = 0; i < result.size(); i += 3)
+        {
+            for (int k = 0; k < 3; ++k)
+            {
+                uint32_t a = result[i + k];
+                uint32_t b = result[i + (k + 1) % 3];
+                // each interior edge is seen from both of its triangles, one direction each
+                if (!locked[a])
+                {
+                    Quadric quadric = quadrics[a];
+                    quadric.add(quadrics[b]);
+                    collapses.push_back({a, b, quadric.evaluate(vertices[b].pos)});
+                }
+            }
+        }
+
+        if (collapses.empty())
+        {
+            break;
+        }
+
+        std::sort(collapses.begin(), collapses.end(), [](const Collapse& x, const Collapse& y) { return x.cost < y.cost; });
+
+        std::iota(remap.begin(), remap.end(), 0);
+        std::fill(touched.begin(), touched.end(), false);
+
+        // a collapse removes about two triangles, stop at the target
+        size_t trianglesToRemove = (result.size() - targetIndexCount) / 3;
+        size_t removed = 0;
+
+        for (const auto& collapse : collapses)
+        {
+            if (removed >= trianglesToRemove)
+            {
+                break;
+            }
+            if (touched[collapse.from] || touched[collapse.to])
+            {
+                continue;
+            }
+
+            std::vector<uint32_t> triangles(vertexTriangles.begin() + triangleOffsets[collapse.from],
+                vertexTriangles.begin() + triangleOffsets[collapse.from + 1]);
+            if (!keepsOrientation(vertices, result, triangles, collapse.from, collapse.to))
+            {
+                continue;
+            }
+
+            // the whole one-ring changes shape, keep it out of the rest of this pass
+            for (uint32_t triangle : triangles)
+            {
+                for (int k = 0; k < 3; ++k)
+                {
+                    touched[result[triangle * 3 + k]] = true;
+                    removed += result[triangle * 3 + k] == collapse.to ? 1 : 0;
+                }
+            }
+
+            remap[collapse.from] = collapse.to;
+            quadrics[collapse.to].add(quadrics[collapse.from]);
+            maxCost = std::max(maxCost, collapse.cost);
+        }
+
+        size_t written = 0;
+        for (size_t i = 0; i < result.size(); i += 3)
+        {
+            uint32_t a = remap[result[i + 0]];
+            uint32_t b = remap[result[i + 1]];
+            uint32_t c = remap[result[i + 2]];
+            if (a != b && b != c && a != c)
+            {
+                result[written++] = a;
+                result[written++] = b;
+                result[written++] = c;
+            }
+        }
+
+        if (written / 3 == triangleCount)
+        {
+            break;
+        }
+        result.resize(written);
+    }
+
+    if (resultError)
+    {
+        *resultError = static_cast<float>(std::sqrt(maxCost));
+    }
+    return result;
+}
+
+std::vector<LodLevel> buildLodChain(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, uint32_t levelCount)
+{
+    std::vector<LodLevel> levels;
+    size_t previousCount = indices.size();
+
+    for (uint32_t level = 1; level <= levelCount; ++level)
+    {
+        // every level starts over from the full mesh, so errors do not compound
+        size_t target = (indices.size() >> level) / 3 * 3;
+        if (target < 3)
+        {
+            break;
+        }
+
+        LodLevel lod;
+        lod.indices = simplifyMesh(vertices, indices, target, &lod.error);
+        if (lod.indices.empty() || lod.indices.size() > previousCount * (1.f - MIN_LOD_REDUCTION))
+        {
+            break;
+        }
+
+        optimizeVertexCache(lod.indices, static_cast<uint32_t>(vertices.size()));
+        previousCount = lod.indices.size();
+        levels.push_back(std::move(lod));
+    }
+
+    return levels;
+}
\ No newline at end of file
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include "vertex_data.hpp"
+
+// one level of detail of a mesh, indexing the same vertices as the full mesh
+struct LodLevel
+{
+    std::vector<uint32_t> indices;
+    // geometric deviation from the full mesh, in object space units
+    float error = 0.f;
+};
+
+// quadric error edge collapse towards targetIndexCount. vertices are only ever collapsed onto other
+// existing vertices, so the result keeps using the same vertex buffer.
+// borders and attribute seams are kept in place
+std::vector<uint32_t> simplifyMesh(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, size_t targetIndexCount, float* resultError = nullptr);
+
+// up to levelCount levels, each targeting half the triangles of the previous one.
+// stops early once a level no longer gets meaningfully smaller
+std::vector<LodLevel> buildLodChain(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, uint32_t levelCount);
\ No newline at end of file
@@ -0,0 +1,142 @@
+#include "mesh_weld.hpp"
+
+#include <cmath>
+#include <cstring>
+
+static const uint32_t VERTEX_KEY_WORDS = 8;
+static const uint32_t EMPTY_SLOT = UINT32_MAX;
+
+// every attribute of a vertex as plain 32-bit words, compared and hashed lane by lane
+struct VertexKey
+{
+    uint32_t words[VERTEX_KEY_WORDS];
+};
+
+static void makeKeys(const std::vector<Vertex>& vertices, float epsilon, std::vector<VertexKey>& keys)
+{
+    keys.resize(vertices.size());
+    float inverseEpsilon = epsilon > 0.f ? 1.f / epsilon : 0.f;
+
+    for (size_t i = 0; i < vertices.size(); ++i)
+    {
+        const Vertex& vertex = vertices[i];
+        const float components[VERTEX_KEY_WORDS] =
+        {
+            vertex.pos.x, vertex.pos.y, vertex.pos.z,
+            vertex.color.x, vertex.color.y, vertex.color.z,
+            vertex.texCoord.x, vertex.texCoord.y
+        };
+
+        if (inverseEpsilon > 0.f)
+        {
+            for (uint32_t j = 0; j < VERTEX_KEY_WORDS; ++j)
+            {
+                keys[i].words[j] = static_cast<uint32_t>(static_cast<int64_t>(std::floor(components[j] * inverseEpsilon + 0.5f)));
+            }
+        }
+        else
+        {
+            for (uint32_t j = 0; j < VERTEX_KEY_WORDS; ++j)
+            {
+                // adding +0 turns -0 into +0, so both signs of zero weld together
+                float component = components[j] + 0.f;
+                memcpy(&keys[i].words[j], &component, sizeof(float));
+            }
+        }
+    }
+}
+
+static uint32_t hashKey(const VertexKey& key)
+{
+    static const uint32_t LANE_MULTIPLIERS[VERTEX_KEY_WORDS] =
+    {
+        0x9e3779b1u, 0x85ebca77u, 0xc2b2ae3du, 0x27d4eb2fu,
+        0x165667b1u, 0xd3a2646cu, 0xfd7046c5u, 0xb55a4f09u
+    };
+
+    // independent multiplies per lane, folded together at the end
+    uint32_t lanes[VERTEX_KEY_WORDS];
+    for (uint32_t j = 0; j < VERTEX_KEY_WORDS; ++j)
+    {
+        lanes[j] = (key.words[j] ^ (key.words[j] >> 16)) * LANE_MULTIPLIERS[j];
+    }
+
+    uint32_t hash = 0;
+    for (uint32_t j = 0; j < VERTEX_KEY_WORDS; ++j)
+    {
+        hash ^= lanes[j];
+    }
+
+    hash ^= hash >> 15;
+    hash *= 0x2c1b3c6du;
+    hash ^= hash >> 12;
+    return hash;
+}
+
+static bool sameKey(const VertexKey& a, const VertexKey& b)
+{
+    return memcmp(a.words, b.words, sizeof(a.words)) == 0;
+}
+
+WeldStats weldVertices(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, float epsilon)
+{
+    WeldStats stats{};
+    stats.verticesBefore = static_cast<uint32_t>(vertices.size());
+
+    if (vertices.empty())
+    {
+        return stats;
+    }
+
+    std::vector<VertexKey> keys;
+    makeKeys(vertices, epsilon, keys);
+
+    // open addressing with linear probing, kept at most half full
+    size_t capacity = 1;
+    while (capacity < vertices.size() * 2)
+    {
+        capacity <<= 1;
+    }
+    // slots hold output positions of unique vertices
+    std::vector<uint32_t> table(capacity, EMPTY_SLOT);
+    size_t mask = capacity - 1;
+
+    std::vector<uint32_t> remap(vertices.size());
+    uint32_t uniqueCount = 0;
+
+    for (uint32_t i = 0; i < vertices.size(); ++i)
+    {
+        size_t slot = hashKey(keys[i]) & mask;
+
+        while (table[slot] != EMPTY_SLOT && !sameKey(keys[table[slot]], keys[i]))
+        {
+            slot = (slot + 1) & mask;
+        }
+
+        if (table[slot] == EMPTY_SLOT)
+        {
+            // first occurrence: moves down to the next free output position,
+            // which is never ahead of i, so unvisited keys stay intact
+            table[slot] = uniqueCount;
+            remap[i] = uniqueCount;
+            keys[uniqueCount] = keys[i];
+            vertices[uniqueCount] = vertices[i];
+            ++uniqueCount;
+        }
+        else
+        {
+            remap[i] = table[slot];
+        }
+    }
+
+    vertices.resize(uniqueCount);
+    vertices.shrink_to_fit();
+
+    for (auto& index : indices)
+    {
+        index = remap[index];
+    }
+
+    stats.verticesAfter = uniqueCount;
+    return stats;
+}
\ No newline at end of file
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include "vertex_data.hpp"
+
+struct WeldStats
+{
+    uint32_t verticesBefore = 0;
+    uint32_t verticesAfter = 0;
+};
+
+// collapses equal vertices and remaps the indices, keeping the first occurrence of every vertex.
+// epsilon == 0 only merges bit-identical vertices, otherwise every component is snapped
+// to a grid of that size before comparing
+WeldStats weldVertices(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, float epsilon = 0.f);
\ No newline at end of file
@@ -0,0 +1,179 @@
+#include "meshlets.hpp"
+
+#include <cmath>
+
+// normal cones wider than this cannot cull anything useful
+static const float MIN_CONE_DOT = 0.1f;
+
+static void computeMeshletBounds(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, Meshlet& meshlet)
+{
+    const uint32_t* triangles = indices.data() + meshlet.firstIndex;
+    uint32_t indexCount = meshlet.triangleCount * 3;
+
+    // sphere around the box of the cluster, not minimal but cheap and conservative
+    glm::vec3 boundsMin = vertices[triangles[0]].pos;
+    glm::vec3 boundsMax = boundsMin;
+    for (uint32_t i = 1; i < indexCount; ++i)
+    {
+        boundsMin = glm::min(boundsMin, vertices[triangles[i]].pos);
+        boundsMax = glm::max(boundsMax, vertices[triangles[i]].pos);
+    }
+
+    glm::vec3 center = (boundsMin + boundsMax) * 0.5f;
+    float radius = 0.f;
+    for (uint32_t i = 0; i < indexCount; ++i)
+    {
+        radius = std::fmax(radius, glm::length(vertices[triangles[i]].pos - center));
+    }
+    meshlet.boundingSphere = glm::vec4(center, radius);
+
+    std::vector<glm::vec3> normals;
+    normals.reserve(meshlet.triangleCount);
+    glm::vec3 normalSum(0.f);
+    for (uint32_t i = 0; i < indexCount; i += 3)
+    {
+        const glm::vec3& p0 = vertices[triangles[i + 0]].pos;
+        const glm::vec3& p1 = vertices[triangles[i + 1]].pos;
+        const glm::vec3& p2 = vertices[triangles[i + 2]].pos;
+
+        glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+        float area = glm::length(normal);
+        if (area > 0.f)
+        {
+            normals.push_back(normal / area);
+            normalSum += normal / area;
+        }
+    }
+
+    // a zero axis with cutoff 1 never passes the backface test
+    meshlet.cone = glm::vec4(0.f, 0.f, 0.f, 1.f);
+
+    float sumLength = glm::length(normalSum);
+    if (normals.empty() || sumLength <= 0.f)
+    {
+        return;
+    }
+
+    glm::vec3 axis = normalSum / sumLength;
+    float minDot = 1.f;
+    for (const auto& normal : normals)
+    {
+        minDot = std::fmin(minDot, glm::dot(axis, normal));
+    }
+
+    if (minDot <= MIN_CONE_DOT)
+    {
+        return;
+    }
+
+    // sine of the cone half angle, the view directions the whole cluster faces away from
+    meshlet.cone = glm::vec4(axis, std::sqrt(1.f - minDot * minDot));
+}
+
+std::vector<Meshlet> buildMeshlets(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices)
+{
+    std::vector<Meshlet> meshlets;
+
+    // vertex -> last meshlet it was counted in, avoids clearing a set per meshlet
+    std::vector<uint32_t> seenIn(vertices.size(), UINT32_MAX);
+
+    Meshlet current{};
+    uint32_t currentId = 0;
+    uint32_t currentVertices = 0;
+
+    auto finish = [&]()
+    {
+        if (current.triangleCount > 0)
+        {
+            computeMeshletBounds(vertices, indices, current);
+            meshlets.push_back(current);
+        }
+    };
+
+    // vertices of triangle i not yet in the current meshlet, a triangle may repeat a vertex
+    auto countNewVertices = [&](uint32_t i)
+    {
+        uint32_t newVertices = 0;
+        for (uint32_t k = 0; k < 3; ++k)
+        {
+            uint32_t index = indices[i + k];
+            bool repeated = (k > 0 && index == indices[i]) || (k > 1 && index == indices[i + 1]);
+            if (seenIn[index] != currentId && !repeated)
+            {
+                ++newVertices;
+            }
+        }
+        return newVertices;
+    };
+
+    for (uint32_t i = 0; i + 2 < indices.size(); i += 3)
+    {
+        uint32_t newVertices = countNewVertices(i);
+
+        if (current.triangleCount == MESHLET_MAX_TRIANGLES || currentVertices + newVertices > MESHLET_MAX_VERTICES)
+        {
+            finish();
+            current = Meshlet{};
+            current.firstIndex = i;
+            ++currentId;
+            currentVertices = 0;
+            newVertices = countNewVertices(i);
+        }
+
+        for (uint32_t k = 0; k < 3; ++k)
+        {
+            seenIn[indices[i + k]] = currentId;
+        }
+        currentVertices += newVertices;
+        ++current.triangleCount;
+    }
+
+    finish();
+    return meshlets;
+}
+
+CullFrustum makeCullFrustum(const glm::mat4& proj, const glm::mat4& view, const glm::mat4& model)
+{
+    CullFrustum frustum{};
+
+    // planes of the clip volume pulled back through the whole transform (Gribb and Hartmann), vulkan depth is 0..1
+    glm::mat4 clip = proj * view * model;
+    glm::vec4 rows[4];
+    for (int i = 0; i < 4; ++i)
+    {
+        rows[i] = glm::vec4(clip[0][i], clip[1][i], clip[2][i], clip[3][i]);
+    }
+
+    frustum.planes[0] = rows[3] + rows[0];
+    frustum.planes[1] = rows[3] - rows[0];
+    frustum.planes[2] = rows[3] + rows[1];
+    frustum.planes[3] = rows[3] - rows[1];
+    frustum.planes[4] = rows[2];
+    frustum.planes[5] = rows[3] - rows[2];
+
+    for (auto& plane : frustum.planes)
+    {
+        plane = plane / glm::length(glm::vec3(plane));
+    }
+
+    frustum.cameraPosition = glm::inverse(view * model) * glm::vec4(0.f, 0.f, 0.f, 1.f);
+    return frustum;
+}
+
+bool isMeshletVisible(const Meshlet& meshlet, const CullFrustum& frustum)
+{
+    glm::vec3 center(meshlet.boundingSphere);
+    float radius = meshlet.boundingSphere.w;
+
+    for (const auto& plane : frustum.planes)
+    {
+        if (glm::dot(glm::vec3(plane), center) + plane.w < -radius)
+        {
+            return false;
+        }
+    }
+
+    // every triangle faces away if the camera lies inside the cone behind the cluster
+    glm::vec3 toCenter = center - glm::vec3(frustum.cameraPosition);
+    return glm::dot(toCenter, glm::vec3(meshlet.cone)) < meshlet.cone.w * glm::length(toCenter) + radius;
+}
\ No newline at end of file
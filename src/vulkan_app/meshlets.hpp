@@ -0,0 +1,47 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <cstdint>
+
+#include "vertex_data.hpp"
+
+const uint32_t MESHLET_MAX_VERTICES = 64;
+const uint32_t MESHLET_MAX_TRIANGLES = 124;
+
+// a cluster of consecutive triangles of a mesh, drawn and culled as a unit.
+// the layout is shared with the culling compute shader
+struct Meshlet
+{
+    // object space, xyz center and w radius
+    glm::vec4 boundingSphere;
+    // xyz axis and w cutoff of the cone containing every triangle normal
+    glm::vec4 cone;
+    // into the index array of the mesh's index type
+    uint32_t firstIndex;
+    uint32_t triangleCount;
+    uint32_t vertexOffset;
+    uint32_t mesh;
+};
+
+// camera as seen from object space, for culling clusters before they are transformed
+struct CullFrustum
+{
+    // left, right, bottom, top, near, far, normalized and pointing inwards
+    glm::vec4 planes[6];
+    glm::vec4 cameraPosition;
+};
+
+// push constants of cull.comp
+struct CullConstants
+{
+    CullFrustum frustum;
+    uint32_t meshletCount;
+};
+
+// meshlets of one mesh, with firstIndex relative to the start of its indices
+std::vector<Meshlet> buildMeshlets(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices);
+
+CullFrustum makeCullFrustum(const glm::mat4& proj, const glm::mat4& view, const glm::mat4& model);
+bool isMeshletVisible(const Meshlet& meshlet, const CullFrustum& frustum);
\ No newline at end of file
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <cstdint>
+
+#include "vertex_data.hpp"
+#include "meshlets.hpp"
+
+// meshes with at most this many vertices are indexed with 16 bits
+const uint32_t INDEX16_VERTEX_LIMIT = 65536;
+
+// levels of detail a mesh can have, including the full mesh
+const uint32_t MAX_MESH_LODS = 6;
+
+// indices of one level of detail, in the same index array as the full mesh
+struct MeshLod
+{
+    uint32_t firstIndex;
+    uint32_t indexCount;
+    // object space deviation from the full mesh
+    float error;
+};
+
+// location of one mesh inside the packed vertex and index arrays
+struct MeshRange
+{
+    glm::mat4 transform;
+    // object space bounds, w unused
+    glm::vec4 boundsMin;
+    glm::vec4 boundsMax;
+    uint32_t firstVertex;
+    uint32_t vertexCount;
+    // counted in indices of indexType, from the start of the index array of that type
+    uint32_t firstIndex;
+    uint32_t indexCount;
+    VkIndexType indexType;
+    uint32_t firstMeshlet;
+    uint32_t meshletCount;
+    // lods[0] is the full mesh, coarser levels follow
+    uint32_t lodCount;
+    MeshLod lods[MAX_MESH_LODS];
+};
+
+// per-mesh constants read by the vertex shader, indexed with the instance index
+struct MeshShaderData
+{
+    glm::vec4 positionOffset;
+    glm::vec4 positionScale;
+};
+
+// non-owning view of packed geometry, either in memory or inside the mesh cache mapping
+struct GeometryView
+{
+    VertexFormat vertexFormat = VertexFormat::Full;
+    const void* vertices = nullptr;
+    uint32_t vertexCount = 0;
+    const uint16_t* indices16 = nullptr;
+    uint32_t index16Count = 0;
+    const uint32_t* indices32 = nullptr;
+    uint32_t index32Count = 0;
+    const Meshlet* meshlets = nullptr;
+    uint32_t meshletCount = 0;
+};
+
+// all meshes of a model laid out back to back, so they can share one vertex buffer and one index buffer per index type.
+// meshes using 16-bit indices come first, so draws of one index type are contiguous
+struct PackedGeometry
+{
+    VertexFormat vertexFormat = VertexFormat::Full;
+    std::vector<Vertex> vertices;
+    std::vector<CompactVertex> compactVertices;
+    std::vector<uint16_t> indices16;
+    std::vector<uint32_t> indices32;
+    // in mesh order, so the meshlets of 16-bit meshes come first as well
+    std::vector<Meshlet> meshlets;
+    std::vector<MeshRange> ranges;
+
+    GeometryView view() const
+    {
+        GeometryView geometryView{};
+        geometryView.vertexFormat = vertexFormat;
+        if (vertexFormat == VertexFormat::Compact)
+        {
+            geometryView.vertices = compactVertices.data();
+            geometryView.vertexCount = static_cast<uint32_t>(compactVertices.size());
+        }
+        else
+        {
+            geometryView.vertices = vertices.data();
+            geometryView.vertexCount = static_cast<uint32_t>(vertices.size());
+        }
+        geometryView.indices16 = indices16.data();
+        geometryView.index16Count = static_cast<uint32_t>(indices16.size());
+        geometryView.indices32 = indices32.data();
+        geometryView.index32Count = static_cast<uint32_t>(indices32.size());
+        geometryView.meshlets = meshlets.data();
+        geometryView.meshletCount = static_cast<uint32_t>(meshlets.size());
+        return geometryView;
+    }
+};
\ No newline at end of file
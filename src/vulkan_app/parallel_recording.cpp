@@ -0,0 +1,277 @@
+#include "vulkan_app.hpp"
+
+static const uint32_t RECORDING_BENCHMARK_REPEATS = 5;
+static const uint32_t RECORDING_BENCHMARK_DRAWS[] = {1000, 10000, 100000};
+
+static VkCommandPool createSecondaryPool(VkDevice device, uint32_t queueFamily)
+{
+    VkCommandPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+    poolInfo.queueFamilyIndex = queueFamily;
+
+    VkCommandPool pool;
+    if (vkCreateCommandPool(device, &poolInfo, nullptr, &pool) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create recording command pool!");
+    }
+    return pool;
+}
+
+static void allocateSecondaries(VkDevice device, VkCommandPool pool, uint32_t count, VkCommandBuffer* commandBuffers)
+{
+    VkCommandBufferAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.commandPool = pool;
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+    allocInfo.commandBufferCount = count;
+
+    if (vkAllocateCommandBuffers(device, &allocInfo, commandBuffers) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to allocate secondary command buffers!");
+    }
+}
+
+void VulkanApp::createRecordingPools()
+{
+    if (!options.parallelRecording)
+    {
+        return;
+    }
+
+    // one pool per chunk of the draw list and frame slot, a chunk is recorded by one thread at a time
+    recordChunkCount = threadPool.size();
+    recordCommandPools.resize(framesInFlight * recordChunkCount);
+    recordCommandBuffers.resize(recordCommandPools.size() * RECORD_PASSES);
+
+    for (size_t i = 0; i < recordCommandPools.size(); ++i)
+    {
+        recordCommandPools[i] = createSecondaryPool(device, graphicsQueueFamily);
+        allocateSecondaries(device, recordCommandPools[i], RECORD_PASSES, &recordCommandBuffers[i * RECORD_PASSES]);
+    }
+
+    SDL_Log("recording draws on up to %u threads", recordChunkCount);
+}
+
+void VulkanApp::cleanupRecordingPools()
+{
+    for (VkCommandPool pool : recordCommandPools)
+    {
+        vkDestroyCommandPool(device, pool, nullptr);
+    }
+    recordCommandPools.clear();
+    recordCommandBuffers.clear();
+}
+
+void VulkanApp::beginSecondaryCommandBuffer(VkCommandBuffer commandBuffer, VkFramebuffer framebuffer)
+{
+    VkCommandBufferInheritanceInfo inheritanceInfo{};
+    inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+    inheritanceInfo.renderPass = renderPass;
+    inheritanceInfo.subpass = 0;
+    inheritanceInfo.framebuffer = framebuffer;
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT | VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    beginInfo.pInheritanceInfo = &inheritanceInfo;
+
+    if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to begin recording secondary command buffer!");
+    }
+}
+
+void VulkanApp::bindPassState(VkCommandBuffer commandBuffer, VkPipeline pipeline, VkBuffer vertexStream)
+{
+    // secondaries inherit nothing but the render pass, so every pass binds its whole state, inline or not
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+
+    VkViewport viewport{};
+    viewport.x = 0.0f;
+    viewport.y = 0.0f;
+    viewport.width = static_cast<float>(swapChainExtent.width);
+    viewport.height = static_cast<float>(swapChainExtent.height);
+    viewport.minDepth = 0.0f;
+    viewport.maxDepth = 1.0f;
+    vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+
+    VkRect2D scissor{};
+    scissor.offset = {0, 0};
+    scissor.extent = swapChainExtent;
+    vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSets[currentFrame],
+        static_cast<uint32_t>(frameUniformOffsets.size()), frameUniformOffsets.data());
+    // direct draws push their own mesh, multi-draws fall back to the instance index
+    pushDrawConstants(commandBuffer, OBJECT_INDEX_FROM_INSTANCE);
+
+    VkDeviceSize offsets[] = {0};
+    vkCmdBindVertexBuffers(commandBuffer, 0, 1, &vertexStream, offsets);
+}
+
+void VulkanApp::recordSceneParallel(VkCommandBuffer commandBuffer, uint32_t imageIndex)
+{
+    uint32_t meshCount = static_cast<uint32_t>(meshRanges.size());
+
+    // multi-draw records two calls per pass whatever the mesh count, only direct draws are worth splitting
+    uint32_t chunkCount = 1;
+    if (indirectBuffer == VK_NULL_HANDLE)
+    {
+        chunkCount = std::clamp(meshCount / RECORD_MIN_DRAWS_PER_CHUNK, 1u, recordChunkCount);
+    }
+
+    struct Pass
+    {
+        VkPipeline pipeline;
+        VkBuffer vertexStream;
+    };
+    std::vector<Pass> passes;
+    if (depthPrepassPipeline && pipelineLibrary.isReady(*depthPrepassPipeline))
+    {
+        passes.push_back({pipelineLibrary.get(*depthPrepassPipeline), positionBuffer});
+    }
+    passes.push_back({pipelineLibrary.get(scenePipeline), vertexBuffer});
+
+    std::vector<VkCommandBuffer> secondaries(passes.size() * chunkCount);
+
+    threadPool.parallelFor(chunkCount, [&](uint32_t chunk)
+    {
+        uint32_t poolIndex = currentFrame * recordChunkCount + chunk;
+        vkResetCommandPool(device, recordCommandPools[poolIndex], 0);
+
+        uint32_t first = static_cast<uint32_t>(static_cast<uint64_t>(meshCount) * chunk / chunkCount);
+        uint32_t last = static_cast<uint32_t>(static_cast<uint64_t>(meshCount) * (chunk + 1) / chunkCount);
+        uint32_t last16 = std::clamp(meshCount16, first, last);
+
+        for (size_t pass = 0; pass < passes.size(); ++pass)
+        {
+            VkCommandBuffer secondary = recordCommandBuffers[poolIndex * RECORD_PASSES + pass];
+            beginSecondaryCommandBuffer(secondary, swapChainFramebuffers[imageIndex]);
+            bindPassState(secondary, passes[pass].pipeline, passes[pass].vertexStream);
+
+            recordMeshDraws(secondary, VK_INDEX_TYPE_UINT16, first, last16 - first);
+            recordMeshDraws(secondary, VK_INDEX_TYPE_UINT32, last16, last - last16);
+
+            if (vkEndCommandBuffer(secondary) != VK_SUCCESS)
+            {
+                throw std::runtime_error("failed to record secondary command buffer!");
+            }
+            // executed pass by pass, the depth prepass completes before shading starts
+            secondaries[pass * chunkCount + chunk] = secondary;
+        }
+    });
+
+    vkCmdExecuteCommands(commandBuffer, static_cast<uint32_t>(secondaries.size()), secondaries.data());
+}
+
+void VulkanApp::runRecordingBenchmark()
+{
+    if (meshRanges.empty())
+    {
+        return;
+    }
+
+    VkCommandBuffer primary = graphicsCommandBuffers[0];
+    VkFramebuffer framebuffer = swapChainFramebuffers[0];
+    uint32_t maxThreads = std::max(1u, std::thread::hardware_concurrency());
+
+    SDL_Log("recording benchmark: synthetic direct draws into secondaries, best of %u", RECORDING_BENCHMARK_REPEATS);
+
+    for (uint32_t drawCount : RECORDING_BENCHMARK_DRAWS)
+    {
+        float singleThreadTime = 0.f;
+
+        for (uint32_t threads = 1; ; threads = std::min(threads * 2, maxThreads))
+        {
+            ThreadPool pool(threads);
+            std::vector<VkCommandPool> commandPools(threads);
+            std::vector<VkCommandBuffer> secondaries(threads);
+            for (uint32_t i = 0; i < threads; ++i)
+            {
+                commandPools[i] = createSecondaryPool(device, graphicsQueueFamily);
+                allocateSecondaries(device, commandPools[i], 1, &secondaries[i]);
+            }
+
+            float best = std::numeric_limits<float>::max();
+            for (uint32_t run = 0; run < RECORDING_BENCHMARK_REPEATS; ++run)
+            {
+                vkResetCommandBuffer(primary, 0);
+
+                auto start = std::chrono::high_resolution_clock::now();
+
+                pool.parallelFor(threads, [&](uint32_t chunk)
+                {
+                    vkResetCommandPool(device, commandPools[chunk], 0);
+
+                    VkCommandBuffer secondary = secondaries[chunk];
+                    beginSecondaryCommandBuffer(secondary, framebuffer);
+                    bindPassState(secondary, pipelineLibrary.get(scenePipeline), vertexBuffer);
+
+                    // the draws cycle through the model's meshes, switching index buffers as the type changes
+                    VkIndexType boundType = VK_INDEX_TYPE_MAX_ENUM;
+                    uint32_t first = static_cast<uint32_t>(static_cast<uint64_t>(drawCount) * chunk / threads);
+                    uint32_t last = static_cast<uint32_t>(static_cast<uint64_t>(drawCount) * (chunk + 1) / threads);
+                    for (uint32_t draw = first; draw < last; ++draw)
+                    {
+                        uint32_t mesh = draw % static_cast<uint32_t>(meshRanges.size());
+                        const MeshRange& range = meshRanges[mesh];
+                        if (range.indexType != boundType)
+                        {
+                            boundType = range.indexType;
+                            vkCmdBindIndexBuffer(secondary, boundType == VK_INDEX_TYPE_UINT16 ? indexBuffer16 : indexBuffer32, 0, boundType);
+                        }
+                        const MeshLod& lod = range.lods[0];
+                        vkCmdDrawIndexed(secondary, lod.indexCount, 1, lod.firstIndex, static_cast<int32_t>(range.firstVertex), mesh);
+                    }
+
+                    if (vkEndCommandBuffer(secondary) != VK_SUCCESS)
+                    {
+                        throw std::runtime_error("failed to record secondary command buffer!");
+                    }
+                });
+
+                VkCommandBufferBeginInfo beginInfo{};
+                beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+                vkBeginCommandBuffer(primary, &beginInfo);
+
+                VkRenderPassBeginInfo renderPassInfo{};
+                renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+                renderPassInfo.renderPass = renderPass;
+                renderPassInfo.framebuffer = framebuffer;
+                renderPassInfo.renderArea.extent = swapChainExtent;
+
+                std::array<VkClearValue, 2> clearValues{};
+                renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
+                renderPassInfo.pClearValues = clearValues.data();
+
+                vkCmdBeginRenderPass(primary, &renderPassInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+                vkCmdExecuteCommands(primary, threads, secondaries.data());
+                vkCmdEndRenderPass(primary);
+                vkEndCommandBuffer(primary);
+
+                auto end = std::chrono::high_resolution_clock::now();
+                best = std::min(best, std::chrono::duration<float, std::chrono::milliseconds::period>(end - start).count());
+            }
+
+            if (threads == 1)
+            {
+                singleThreadTime = best;
+            }
+            SDL_Log("  %6u draws, %2u threads: %.3f ms, speedup x%.2f", drawCount, threads, best, singleThreadTime / best);
+
+            for (VkCommandPool commandPool : commandPools)
+            {
+                vkDestroyCommandPool(device, commandPool, nullptr);
+            }
+
+            if (threads == maxThreads)
+            {
+                break;
+            }
+        }
+    }
+
+    // nothing was submitted, the primary is left for the frames to reset
+    vkResetCommandBuffer(primary, 0);
+}
\ No newline at end of file
@@ -0,0 +1,121 @@
+#include "pipeline_cache.hpp"
+#include "mapped_file.hpp"
+
+#include <SDL2/SDL.h>
+
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+void PipelineCache::init(VkPhysicalDevice physicalDevice, VkDevice device, const std::string& path, bool ignoreExisting)
+{
+    this->device = device;
+    this->path = path;
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+
+    VkPipelineCacheCreateInfo cacheInfo{};
+    cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+
+    // the mapping only has to outlive vkCreatePipelineCache, which copies the data
+    MappedFile file;
+    if (!ignoreExisting && file.open(path))
+    {
+        if (isCompatible(file.data(), file.size()))
+        {
+            cacheInfo.initialDataSize = file.size();
+            cacheInfo.pInitialData = file.data();
+            warm = true;
+        }
+        else
+        {
+            SDL_Log("pipeline cache %s was written by another device or driver, starting cold", path.c_str());
+        }
+    }
+
+    if (vkCreatePipelineCache(device, &cacheInfo, nullptr, &cache) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create pipeline cache!");
+    }
+
+    if (warm)
+    {
+        SDL_Log("pipeline cache %s: %.1f KiB loaded", path.c_str(), file.size() / 1024.f);
+    }
+}
+
+void PipelineCache::cleanup()
+{
+    if (!write())
+    {
+        SDL_Log("failed to write pipeline cache %s", path.c_str());
+    }
+
+    vkDestroyPipelineCache(device, cache, nullptr);
+    cache = VK_NULL_HANDLE;
+}
+
+bool PipelineCache::isCompatible(const uint8_t* data, size_t size) const
+{
+    if (size < sizeof(VkPipelineCacheHeaderVersionOne))
+    {
+        return false;
+    }
+
+    VkPipelineCacheHeaderVersionOne header;
+    memcpy(&header, data, sizeof(header));
+
+    // the driver checks this too, but rejecting early keeps a stale cache from being loaded at all
+    return header.headerSize >= sizeof(VkPipelineCacheHeaderVersionOne) &&
+        header.headerSize <= size &&
+        header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+        header.vendorID == properties.vendorID &&
+        header.deviceID == properties.deviceID &&
+        memcmp(header.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+}
+
+bool PipelineCache::write() const
+{
+    size_t size = 0;
+    if (vkGetPipelineCacheData(device, cache, &size, nullptr) != VK_SUCCESS)
+    {
+        return false;
+    }
+
+    std::vector<uint8_t> data(size);
+    if (vkGetPipelineCacheData(device, cache, &size, data.data()) != VK_SUCCESS)
+    {
+        return false;
+    }
+
+    return writeFileAtomically(path, data.data(), size);
+}
+
+VkResult PipelineCache::createGraphicsPipeline(const VkGraphicsPipelineCreateInfo& pipelineInfo, VkPipeline& pipeline)
+{
+    auto start = std::chrono::high_resolution_clock::now();
+    VkResult result = vkCreateGraphicsPipelines(device, cache, 1, &pipelineInfo, nullptr, &pipeline);
+    addCreation(std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count());
+    return result;
+}
+
+VkResult PipelineCache::createComputePipeline(const VkComputePipelineCreateInfo& pipelineInfo, VkPipeline& pipeline)
+{
+    auto start = std::chrono::high_resolution_clock::now();
+    VkResult result = vkCreateComputePipelines(device, cache, 1, &pipelineInfo, nullptr, &pipeline);
+    addCreation(std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count());
+    return result;
+}
+
+void PipelineCache::addCreation(double milliseconds)
+{
+    std::lock_guard<std::mutex> lock(statsMutex);
+    ++stats.pipelineCount;
+    stats.creationMilliseconds += milliseconds;
+}
+
+PipelineCacheStats PipelineCache::getStats() const
+{
+    std::lock_guard<std::mutex> lock(statsMutex);
+    return stats;
+}
\ No newline at end of file
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <mutex>
+#include <string>
+#include <cstdint>
+
+struct PipelineCacheStats
+{
+    uint32_t pipelineCount = 0;
+    double creationMilliseconds = 0.0;
+};
+
+// driver pipeline cache kept on disk between runs, dropped when another device or driver wrote it
+class PipelineCache
+{
+public:
+    // ignoring the file on disk measures a cold start, the cache is still written back
+    void init(VkPhysicalDevice physicalDevice, VkDevice device, const std::string& path, bool ignoreExisting);
+    // writes the cache back and destroys it
+    void cleanup();
+
+    VkPipelineCache get() const { return cache; }
+    // whether the pipelines created so far could come out of a cache loaded from disk
+    bool isWarm() const { return warm; }
+
+    // timed creation through the cache, safe to call from several threads at once
+    VkResult createGraphicsPipeline(const VkGraphicsPipelineCreateInfo& pipelineInfo, VkPipeline& pipeline);
+    VkResult createComputePipeline(const VkComputePipelineCreateInfo& pipelineInfo, VkPipeline& pipeline);
+
+    PipelineCacheStats getStats() const;
+
+private:
+    bool isCompatible(const uint8_t* data, size_t size) const;
+    bool write() const;
+    void addCreation(double milliseconds);
+
+    VkDevice device = VK_NULL_HANDLE;
+    VkPhysicalDeviceProperties properties{};
+    VkPipelineCache cache = VK_NULL_HANDLE;
+    std::string path;
+    bool warm = false;
+
+    mutable std::mutex statsMutex;
+    PipelineCacheStats stats;
+};
\ No newline at end of file
@@ -0,0 +1,444 @@
+#include "pipeline_library.hpp"
+#include "load_shader.hpp"
+
+#include <SDL2/SDL.h>
+
+#include <chrono>
+#include <stdexcept>
+
+static const uint64_t FNV_OFFSET_BASIS = 14695981039346656037ull;
+
+// 64-bit FNV-1a
+static uint64_t hashBytes(const void* data, size_t size, uint64_t hash = FNV_OFFSET_BASIS)
+{
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < size; ++i)
+    {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+static std::string describe(const GraphicsPipelineKey& key)
+{
+    std::string stages = key.fragmentShader.empty() ? key.vertexShader : key.vertexShader + " + " + key.fragmentShader;
+    return key.features == 0 ? stages : stages + " (features " + std::to_string(key.features) + ")";
+}
+
+bool GraphicsPipelineKey::operator==(const GraphicsPipelineKey& other) const
+{
+    return vertexShader == other.vertexShader &&
+        fragmentShader == other.fragmentShader &&
+        features == other.features &&
+        vertexFormat == other.vertexFormat &&
+        positionOnly == other.positionOnly &&
+        depthCompareOp == other.depthCompareOp &&
+        colorWrites == other.colorWrites &&
+        cullMode == other.cullMode;
+}
+
+uint64_t GraphicsPipelineKey::hash() const
+{
+    // field by field, the struct itself may contain padding; the lengths keep the two paths apart
+    uint64_t hash = FNV_OFFSET_BASIS;
+    uint64_t vertexShaderLength = vertexShader.size();
+    hash = hashBytes(&vertexShaderLength, sizeof(vertexShaderLength), hash);
+    hash = hashBytes(vertexShader.data(), vertexShader.size(), hash);
+    hash = hashBytes(fragmentShader.data(), fragmentShader.size(), hash);
+    hash = hashBytes(&features, sizeof(features), hash);
+    uint32_t format = static_cast<uint32_t>(vertexFormat);
+    hash = hashBytes(&format, sizeof(format), hash);
+    uint8_t positions = positionOnly ? 1 : 0;
+    hash = hashBytes(&positions, sizeof(positions), hash);
+    uint32_t compareOp = static_cast<uint32_t>(depthCompareOp);
+    hash = hashBytes(&compareOp, sizeof(compareOp), hash);
+    uint8_t colors = colorWrites ? 1 : 0;
+    hash = hashBytes(&colors, sizeof(colors), hash);
+    uint32_t cull = static_cast<uint32_t>(cullMode);
+    hash = hashBytes(&cull, sizeof(cull), hash);
+    return hash;
+}
+
+void PipelineLibrary::init(VkDevice device, PipelineCache* cache, ThreadPool* threadPool, const ShaderVariants* variants, VkPipelineLayout layout, VkRenderPass renderPass)
+{
+    this->device = device;
+    this->cache = cache;
+    this->threadPool = threadPool;
+    this->variants = variants;
+    this->layout = layout;
+    this->renderPass = renderPass;
+}
+
+void PipelineLibrary::cleanup()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    idle.wait(lock, [this] { return compiling == 0; });
+
+    for (const Entry& entry : entries)
+    {
+        if (entry.pipeline != VK_NULL_HANDLE)
+        {
+            vkDestroyPipeline(device, entry.pipeline, nullptr);
+        }
+    }
+    entries.clear();
+    handlesByHash.clear();
+}
+
+PipelineHandle PipelineLibrary::findOrAdd(const GraphicsPipelineKey& key, bool& added)
+{
+    ++stats.requestCount;
+
+    std::vector<PipelineHandle>& candidates = handlesByHash[key.hash()];
+    for (PipelineHandle handle : candidates)
+    {
+        if (entries[handle].key == key)
+        {
+            ++stats.deduplicatedCount;
+            added = false;
+            return handle;
+        }
+    }
+
+    Entry entry;
+    entry.key = key;
+    entries.push_back(std::move(entry));
+
+    PipelineHandle handle = static_cast<PipelineHandle>(entries.size() - 1);
+    candidates.push_back(handle);
+    added = true;
+    return handle;
+}
+
+PipelineHandle PipelineLibrary::setFallback(const GraphicsPipelineKey& key)
+{
+    bool added;
+    PipelineHandle handle;
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        handle = findOrAdd(key, added);
+        if (!added)
+        {
+            // requested before, a worker may still be on it
+            idle.wait(lock, [this, handle] { return entries[handle].ready || compiling == 0; });
+            if (!entries[handle].ready)
+            {
+                throw std::runtime_error("failed to create fallback pipeline!");
+            }
+            fallback = handle;
+            return handle;
+        }
+    }
+
+    // nothing can stand in for the fallback, a failure here is fatal
+    VkPipeline pipeline = compile(key);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    entries[handle].pipeline = pipeline;
+    entries[handle].ready = true;
+    ++stats.compiledCount;
+    fallback = handle;
+    return handle;
+}
+
+PipelineHandle PipelineLibrary::request(const GraphicsPipelineKey& key)
+{
+    bool added;
+    PipelineHandle handle;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        handle = findOrAdd(key, added);
+        if (!added)
+        {
+            return handle;
+        }
+        ++compiling;
+    }
+
+    threadPool->submit([this, handle, key]()
+    {
+        auto start = std::chrono::high_resolution_clock::now();
+
+        VkPipeline pipeline = VK_NULL_HANDLE;
+        try
+        {
+            pipeline = compile(key);
+        }
+        catch (const std::exception& error)
+        {
+            SDL_Log("pipeline %s failed to compile, its draws keep the fallback: %s", describe(key).c_str(), error.what());
+        }
+
+        float milliseconds = std::chrono::duration<float, std::chrono::milliseconds::period>(std::chrono::high_resolution_clock::now() - start).count();
+        if (pipeline != VK_NULL_HANDLE)
+        {
+            SDL_Log("pipeline %s compiled in %.2f ms on a worker thread", describe(key).c_str(), milliseconds);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            entries[handle].pipeline = pipeline;
+            entries[handle].ready = pipeline != VK_NULL_HANDLE;
+            if (entries[handle].ready)
+            {
+                ++stats.compiledCount;
+                completed = true;
+            }
+            else
+            {
+                ++stats.failedCount;
+            }
+            --compiling;
+            // under the lock, cleanup() may return and the library go away as soon as it is released
+            idle.notify_all();
+        }
+    });
+
+    return handle;
+}
+
+bool PipelineLibrary::isReady(PipelineHandle handle) const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return entries[handle].ready;
+}
+
+VkPipeline PipelineLibrary::get(PipelineHandle handle) const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    const Entry& entry = entries[handle];
+    return entry.ready ? entry.pipeline : entries[fallback].pipeline;
+}
+
+bool PipelineLibrary::takeCompleted()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    bool result = completed;
+    completed = false;
+    return result;
+}
+
+PipelineLibraryStats PipelineLibrary::getStats() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return stats;
+}
+
+VkShaderModule PipelineLibrary::createShaderModule(const std::string& path) const
+{
+    auto code = readBinaryFile(path);
+
+    VkShaderModuleCreateInfo createInfo{};
+    createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    createInfo.codeSize = code.size();
+    createInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
+
+    VkShaderModule shaderModule;
+    if (vkCreateShaderModule(device, &createInfo, nullptr, &shaderModule) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create shader module!");
+    }
+
+    return shaderModule;
+}
+
+VkPipeline PipelineLibrary::compile(const GraphicsPipelineKey& key) const
+{
+    // SHADER STAGES
+
+    // the features pick a precompiled permutation and set its specialization constants,
+    // the variants have to live until the pipeline is created
+    ShaderVariant vertVariant = variants->select(key.vertexShader, key.features);
+    VkSpecializationInfo vertSpecialization = vertVariant.getSpecializationInfo();
+    ShaderVariant fragVariant;
+    VkSpecializationInfo fragSpecialization{};
+    if (!key.fragmentShader.empty())
+    {
+        fragVariant = variants->select(key.fragmentShader, key.features);
+        fragSpecialization = fragVariant.getSpecializationInfo();
+    }
+
+    std::vector<VkPipelineShaderStageCreateInfo> shaderStages;
+
+    VkPipelineShaderStageCreateInfo vertShaderStageInfo{};
+    vertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    vertShaderStageInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
+    vertShaderStageInfo.module = createShaderModule(vertVariant.path);
+    vertShaderStageInfo.pName = "main";
+    vertShaderStageInfo.pSpecializationInfo = vertVariant.values.empty() ? nullptr : &vertSpecialization;
+    shaderStages.push_back(vertShaderStageInfo);
+
+    if (!key.fragmentShader.empty())
+    {
+        VkPipelineShaderStageCreateInfo fragShaderStageInfo{};
+        fragShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        fragShaderStageInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+        try
+        {
+            fragShaderStageInfo.module = createShaderModule(fragVariant.path);
+        }
+        catch (...)
+        {
+            vkDestroyShaderModule(device, vertShaderStageInfo.module, nullptr);
+            throw;
+        }
+        fragShaderStageInfo.pName = "main";
+        fragShaderStageInfo.pSpecializationInfo = fragVariant.values.empty() ? nullptr : &fragSpecialization;
+        shaderStages.push_back(fragShaderStageInfo);
+    }
+
+    // VERTEX INPUT STATE
+
+    // the shader reads both layouts as floats, only the fetch formats differ
+    VkVertexInputBindingDescription bindingDescription;
+    std::vector<VkVertexInputAttributeDescription> attributeDescriptions;
+    if (key.positionOnly)
+    {
+        bindingDescription = getPositionBindingDescription(key.vertexFormat);
+        attributeDescriptions.push_back(getPositionAttributeDescription(key.vertexFormat));
+    }
+    else if (key.vertexFormat == VertexFormat::Compact)
+    {
+        bindingDescription = CompactVertex::getBindingDescription();
+        auto compactAttributes = CompactVertex::getAttributeDescriptions();
+        attributeDescriptions.assign(compactAttributes.begin(), compactAttributes.end());
+    }
+    else
+    {
+        bindingDescription = Vertex::getBindingDescription();
+        auto fullAttributes = Vertex::getAttributeDescriptions();
+        attributeDescriptions.assign(fullAttributes.begin(), fullAttributes.end());
+    }
+
+    VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
+    vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+    vertexInputInfo.vertexBindingDescriptionCount = 1;
+    vertexInputInfo.pVertexBindingDescriptions = &bindingDescription;
+    vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
+    vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
+
+    // INPUT ASSEMBLY STATE
+
+    VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
+    inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+    inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+    inputAssembly.primitiveRestartEnable = VK_FALSE;
+
+    // DYNAMIC STATES
+
+    // the viewport follows the swapchain without recompiling
+    std::vector<VkDynamicState> dynamicStates =
+    {
+        VK_DYNAMIC_STATE_VIEWPORT,
+        VK_DYNAMIC_STATE_SCISSOR
+    };
+
+    VkPipelineDynamicStateCreateInfo dynamicState{};
+    dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+    dynamicState.dynamicStateCount = static_cast<uint32_t>(dynamicStates.size());
+    dynamicState.pDynamicStates = dynamicStates.data();
+
+    VkPipelineViewportStateCreateInfo viewportState{};
+    viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+    viewportState.viewportCount = 1;
+    viewportState.scissorCount = 1;
+
+    // DEPTH TESTING STATE
+
+    VkPipelineDepthStencilStateCreateInfo depthStencil{};
+    depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+    depthStencil.depthTestEnable = VK_TRUE;
+    depthStencil.depthWriteEnable = VK_TRUE;
+    depthStencil.depthCompareOp = key.depthCompareOp;
+    depthStencil.depthBoundsTestEnable = VK_FALSE;
+    depthStencil.minDepthBounds = 0.0f;
+    depthStencil.maxDepthBounds = 1.0f;
+    depthStencil.stencilTestEnable = VK_FALSE;
+    depthStencil.front = {};
+    depthStencil.back = {};
+
+    // RASTERIZER STATE
+
+    VkPipelineRasterizationStateCreateInfo rasterizer{};
+    rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+    rasterizer.depthClampEnable = VK_FALSE;
+    rasterizer.rasterizerDiscardEnable = VK_FALSE;
+    rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
+    rasterizer.lineWidth = 1.0f;
+    rasterizer.cullMode = key.cullMode;
+    rasterizer.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+    rasterizer.depthBiasEnable = VK_FALSE;
+    rasterizer.depthBiasConstantFactor = 0.0f;
+    rasterizer.depthBiasClamp = 0.0f;
+    rasterizer.depthBiasSlopeFactor = 0.0f;
+
+    // MULTISAMPLING STATE
+
+    VkPipelineMultisampleStateCreateInfo multisampling{};
+    multisampling.sType                 = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+    multisampling.sampleShadingEnable   = VK_FALSE;
+    multisampling.rasterizationSamples  = VK_SAMPLE_COUNT_1_BIT;
+    multisampling.minSampleShading      = 1.0f;
+    multisampling.pSampleMask           = nullptr;
+    multisampling.alphaToCoverageEnable = VK_FALSE;
+    multisampling.alphaToOneEnable      = VK_FALSE;
+
+    // COLOR BLENDING STATE
+
+    VkPipelineColorBlendAttachmentState colorBlendAttachment{};
+    colorBlendAttachment.colorWriteMask      = key.colorWrites ? VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT : 0;
+    colorBlendAttachment.blendEnable         = VK_FALSE;
+    colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_ONE;
+    colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ZERO;
+    colorBlendAttachment.colorBlendOp        = VK_BLEND_OP_ADD;
+    colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+    colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+    colorBlendAttachment.alphaBlendOp        = VK_BLEND_OP_ADD;
+
+    VkPipelineColorBlendStateCreateInfo colorBlending{};
+    colorBlending.sType             = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+    colorBlending.logicOpEnable     = VK_FALSE;
+    colorBlending.logicOp           = VK_LOGIC_OP_COPY;
+    colorBlending.attachmentCount   = 1;
+    colorBlending.pAttachments      = &colorBlendAttachment;
+    colorBlending.blendConstants[0] = 0.0f;
+    colorBlending.blendConstants[1] = 0.0f;
+    colorBlending.blendConstants[2] = 0.0f;
+    colorBlending.blendConstants[3] = 0.0f;
+
+    // PIPELINE CREATION
+
+    VkGraphicsPipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType               = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    pipelineInfo.stageCount          = static_cast<uint32_t>(shaderStages.size());
+    pipelineInfo.pStages             = shaderStages.data();
+    pipelineInfo.pVertexInputState   = &vertexInputInfo;
+    pipelineInfo.pInputAssemblyState = &inputAssembly;
+    pipelineInfo.pViewportState      = &viewportState;
+    pipelineInfo.pRasterizationState = &rasterizer;
+    pipelineInfo.pMultisampleState   = &multisampling;
+    pipelineInfo.pDepthStencilState  = &depthStencil;
+    pipelineInfo.pColorBlendState    = &colorBlending;
+    pipelineInfo.pDynamicState       = &dynamicState;
+    pipelineInfo.layout              = layout;
+    pipelineInfo.renderPass          = renderPass;
+    pipelineInfo.subpass             = 0;
+    pipelineInfo.basePipelineHandle  = VK_NULL_HANDLE;
+    pipelineInfo.basePipelineIndex   = -1;
+
+    VkPipeline pipeline;
+    VkResult result = cache->createGraphicsPipeline(pipelineInfo, pipeline);
+
+    for (const auto& stage : shaderStages)
+    {
+        vkDestroyShaderModule(device, stage.module, nullptr);
+    }
+
+    if (result != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create graphics pipeline!");
+    }
+
+    return pipeline;
+}
\ No newline at end of file
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <cstdint>
+
+#include "vertex_data.hpp"
+#include "pipeline_cache.hpp"
+#include "thread_pool.hpp"
+#include "shader_variants.hpp"
+
+using PipelineHandle = uint32_t;
+
+// everything a graphics pipeline of the scene render pass is built from, two equal keys share one pipeline
+struct GraphicsPipelineKey
+{
+    // shader source names, resolved to SPIR-V through the shader variants
+    std::string vertexShader;
+    // empty for depth-only pipelines
+    std::string fragmentShader;
+    // ShaderFeature bits, pick the variant of each stage
+    uint32_t features = 0;
+    VertexFormat vertexFormat = VertexFormat::Full;
+    // reads the position-only stream instead of the full vertices
+    bool positionOnly = false;
+    VkCompareOp depthCompareOp = VK_COMPARE_OP_LESS;
+    bool colorWrites = true;
+    VkCullModeFlags cullMode = VK_CULL_MODE_BACK_BIT;
+
+    bool operator==(const GraphicsPipelineKey& other) const;
+    uint64_t hash() const;
+};
+
+struct PipelineLibraryStats
+{
+    uint32_t requestCount = 0;
+    // requests answered with a pipeline requested before
+    uint32_t deduplicatedCount = 0;
+    uint32_t compiledCount = 0;
+    uint32_t failedCount = 0;
+};
+
+// compiles pipelines on the worker threads, draws bind the designated fallback until theirs is ready
+class PipelineLibrary
+{
+public:
+    void init(VkDevice device, PipelineCache* cache, ThreadPool* threadPool, const ShaderVariants* variants, VkPipelineLayout layout, VkRenderPass renderPass);
+    // waits for the compilations still running and destroys every pipeline
+    void cleanup();
+
+    // compiled right away on the calling thread, stands in for every pipeline that is not ready yet
+    PipelineHandle setFallback(const GraphicsPipelineKey& key);
+    // compiled on a worker unless a pipeline with the same state was requested before
+    PipelineHandle request(const GraphicsPipelineKey& key);
+
+    bool isReady(PipelineHandle handle) const;
+    // the pipeline, or the fallback while it is compiling or when it failed to
+    VkPipeline get(PipelineHandle handle) const;
+
+    // whether a pipeline became ready since the last call, commands recorded with the fallback are stale then
+    bool takeCompleted();
+
+    PipelineLibraryStats getStats() const;
+
+private:
+    struct Entry
+    {
+        GraphicsPipelineKey key;
+        VkPipeline pipeline = VK_NULL_HANDLE;
+        bool ready = false;
+    };
+
+    // returns the entry with the same state, or adds one that still has to be compiled
+    PipelineHandle findOrAdd(const GraphicsPipelineKey& key, bool& added);
+    VkPipeline compile(const GraphicsPipelineKey& key) const;
+    VkShaderModule createShaderModule(const std::string& path) const;
+
+    VkDevice device = VK_NULL_HANDLE;
+    PipelineCache* cache = nullptr;
+    ThreadPool* threadPool = nullptr;
+    const ShaderVariants* variants = nullptr;
+    VkPipelineLayout layout = VK_NULL_HANDLE;
+    VkRenderPass renderPass = VK_NULL_HANDLE;
+
+    // entries never move, workers fill in their pipeline under the lock
+    mutable std::mutex mutex;
+    std::condition_variable idle;
+    std::deque<Entry> entries;
+    std::unordered_map<uint64_t, std::vector<PipelineHandle>> handlesByHash;
+    PipelineHandle fallback = 0;
+    uint32_t compiling = 0;
+    bool completed = false;
+    PipelineLibraryStats stats;
+};
\ No newline at end of file
@@ -0,0 +1,648 @@
+#include "render_graph.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <stdexcept>
+
+struct UsageState
+{
+    const char* name;
+    VkPipelineStageFlags2 stages;
+    VkAccessFlags2 access;
+    VkImageLayout layout;
+    bool write;
+};
+
+static UsageState usageState(ResourceUsage usage)
+{
+    switch (usage)
+    {
+    case ResourceUsage::None:
+        return {"none", VK_PIPELINE_STAGE_2_NONE, VK_ACCESS_2_NONE, VK_IMAGE_LAYOUT_UNDEFINED, false};
+    case ResourceUsage::Acquired:
+        return {"acquired", VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_2_NONE, VK_IMAGE_LAYOUT_UNDEFINED, false};
+    case ResourceUsage::IndirectRead:
+        return {"indirect read", VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT, VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED, false};
+    case ResourceUsage::ComputeRead:
+        return {"compute read", VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT, VK_IMAGE_LAYOUT_GENERAL, false};
+    case ResourceUsage::ComputeWrite:
+        return {"compute write", VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+            VK_IMAGE_LAYOUT_GENERAL, true};
+    case ResourceUsage::FragmentSampled:
+        return {"fragment sampled", VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT, VK_ACCESS_2_SHADER_SAMPLED_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, false};
+    case ResourceUsage::ColorAttachment:
+        return {"color attachment", VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_2_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT,
+            VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, true};
+    case ResourceUsage::DepthAttachment:
+        return {"depth attachment", VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT,
+            VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, true};
+    case ResourceUsage::TransferRead:
+        return {"transfer read", VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_READ_BIT, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, false};
+    case ResourceUsage::TransferWrite:
+        return {"transfer write", VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, true};
+    case ResourceUsage::HostRead:
+        return {"host read", VK_PIPELINE_STAGE_2_HOST_BIT, VK_ACCESS_2_HOST_READ_BIT, VK_IMAGE_LAYOUT_GENERAL, false};
+    case ResourceUsage::Present:
+        return {"present", VK_PIPELINE_STAGE_2_NONE, VK_ACCESS_2_NONE, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, false};
+    }
+    throw std::invalid_argument("unknown resource usage!");
+}
+
+// only writes have to be made available, read bits in a source access mask do nothing
+static const VkAccessFlags2 WRITE_ACCESS = VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT | VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT |
+    VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT | VK_ACCESS_2_TRANSFER_WRITE_BIT | VK_ACCESS_2_HOST_WRITE_BIT;
+
+static const char* layoutName(VkImageLayout layout)
+{
+    switch (layout)
+    {
+    case VK_IMAGE_LAYOUT_UNDEFINED: return "undefined";
+    case VK_IMAGE_LAYOUT_GENERAL: return "general";
+    case VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL: return "color attachment";
+    case VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL: return "depth stencil attachment";
+    case VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL: return "shader read only";
+    case VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL: return "transfer src";
+    case VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL: return "transfer dst";
+    case VK_IMAGE_LAYOUT_PRESENT_SRC_KHR: return "present src";
+    default: return "other";
+    }
+}
+
+// what the barriers so far guarantee about one resource
+struct TrackedState
+{
+    VkPipelineStageFlags2 writeStages = VK_PIPELINE_STAGE_2_NONE;
+    VkAccessFlags2 writeAccess = VK_ACCESS_2_NONE;
+    // readers since the last write, a later write waits for them
+    VkPipelineStageFlags2 readStages = VK_PIPELINE_STAGE_2_NONE;
+    // the last write is already visible to these
+    VkPipelineStageFlags2 visibleStages = VK_PIPELINE_STAGE_2_NONE;
+    VkAccessFlags2 visibleAccess = VK_ACCESS_2_NONE;
+    VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+    ResourceUsage last = ResourceUsage::None;
+};
+
+static TrackedState initialState(ResourceUsage before)
+{
+    UsageState state = usageState(before);
+
+    TrackedState tracked;
+    if (state.write)
+    {
+        tracked.writeStages = state.stages;
+        tracked.writeAccess = state.access & WRITE_ACCESS;
+    }
+    else
+    {
+        tracked.readStages = state.stages;
+    }
+    tracked.layout = state.layout;
+    tracked.last = before;
+    return tracked;
+}
+
+// source half of the barrier a use needs, if it needs one
+struct Transition
+{
+    bool needed = false;
+    ResourceUsage from;
+    VkPipelineStageFlags2 srcStages = VK_PIPELINE_STAGE_2_NONE;
+    VkAccessFlags2 srcAccess = VK_ACCESS_2_NONE;
+    VkImageLayout oldLayout;
+};
+
+// moves the tracked resource into the new use
+static Transition advance(TrackedState& tracked, bool image, ResourceUsage usage, bool write)
+{
+    UsageState state = usageState(usage);
+    VkImageLayout newLayout = image ? state.layout : VK_IMAGE_LAYOUT_UNDEFINED;
+    bool layoutChange = image && newLayout != tracked.layout;
+
+    Transition transition;
+    transition.from = tracked.last;
+    transition.oldLayout = tracked.layout;
+
+    if (write || layoutChange)
+    {
+        // write after write needs the earlier write, write after read only has to wait for the readers;
+        // a layout transition is a write of its own
+        transition.srcStages = tracked.writeStages | tracked.readStages;
+        transition.srcAccess = tracked.writeAccess;
+        transition.needed = layoutChange || transition.srcStages != VK_PIPELINE_STAGE_2_NONE;
+
+        tracked.writeStages = state.stages;
+        tracked.writeAccess = write ? state.access & WRITE_ACCESS : VK_ACCESS_2_NONE;
+        tracked.readStages = VK_PIPELINE_STAGE_2_NONE;
+        // the transition is made visible to this use, a write of its own is visible to nobody yet
+        tracked.visibleStages = write ? VK_PIPELINE_STAGE_2_NONE : state.stages;
+        tracked.visibleAccess = write ? VK_ACCESS_2_NONE : state.access;
+    }
+    else
+    {
+        // read after read needs nothing, read after write only once per stage and access
+        bool unseen = (state.stages & ~tracked.visibleStages) != 0 || (state.access & ~tracked.visibleAccess) != 0;
+        if (tracked.writeStages != VK_PIPELINE_STAGE_2_NONE && unseen)
+        {
+            transition.needed = true;
+            transition.srcStages = tracked.writeStages;
+            transition.srcAccess = tracked.writeAccess;
+            tracked.visibleStages |= state.stages;
+            tracked.visibleAccess |= state.access;
+        }
+        tracked.readStages |= state.stages;
+    }
+
+    tracked.layout = image ? newLayout : VK_IMAGE_LAYOUT_UNDEFINED;
+    tracked.last = usage;
+    return transition;
+}
+
+RenderGraph::Pass& RenderGraph::Pass::read(RenderResource resource, ResourceUsage usage)
+{
+    uses.push_back({resource, usage, false});
+    return *this;
+}
+
+RenderGraph::Pass& RenderGraph::Pass::write(RenderResource resource, ResourceUsage usage)
+{
+    uses.push_back({resource, usage, true});
+    return *this;
+}
+
+RenderGraph::Pass& RenderGraph::Pass::keep()
+{
+    sideEffects = true;
+    return *this;
+}
+
+void RenderGraph::init(VkDevice device, MemoryAllocator* allocator, PFN_vkCmdPipelineBarrier2KHR cmdPipelineBarrier2)
+{
+    this->device = device;
+    this->allocator = allocator;
+    this->cmdPipelineBarrier2 = cmdPipelineBarrier2;
+}
+
+RenderResource RenderGraph::importImage(const std::string& name, VkImageAspectFlags aspect, ResourceUsage before)
+{
+    Resource resource;
+    resource.name = name;
+    resource.image = true;
+    resource.aspect = aspect;
+    resource.before = before;
+    resources.push_back(resource);
+    return static_cast<RenderResource>(resources.size() - 1);
+}
+
+RenderResource RenderGraph::importBuffer(const std::string& name, ResourceUsage before)
+{
+    Resource resource;
+    resource.name = name;
+    resource.before = before;
+    resources.push_back(resource);
+    return static_cast<RenderResource>(resources.size() - 1);
+}
+
+RenderResource RenderGraph::createImage(const std::string& name, const TransientImageInfo& info)
+{
+    Resource resource;
+    resource.name = name;
+    resource.image = true;
+    resource.transient = true;
+    resource.aspect = info.aspect;
+    resource.info = info;
+    resources.push_back(resource);
+    return static_cast<RenderResource>(resources.size() - 1);
+}
+
+RenderGraph::Pass& RenderGraph::addPass(const std::string& name, std::function<void(VkCommandBuffer)> record)
+{
+    passes.emplace_back();
+    Pass& pass = passes.back();
+    pass.name = name;
+    pass.record = std::move(record);
+    return pass;
+}
+
+void RenderGraph::output(RenderResource resource, ResourceUsage after)
+{
+    resources[resource].output = true;
+    resources[resource].after = after;
+}
+
+void RenderGraph::compile()
+{
+    cullPasses();
+    allocateTransients();
+    scheduleBarriers();
+}
+
+void RenderGraph::cullPasses()
+{
+    // walking backwards, a pass lives if it writes something a later live pass or the output needs
+    std::vector<bool> needed(resources.size(), false);
+    for (size_t i = 0; i < resources.size(); ++i)
+    {
+        needed[i] = resources[i].output;
+    }
+
+    for (size_t i = passes.size(); i-- > 0;)
+    {
+        Pass& pass = passes[i];
+        pass.live = pass.sideEffects;
+        for (const Pass::Use& use : pass.uses)
+        {
+            if (use.write && needed[use.resource])
+            {
+                pass.live = true;
+            }
+        }
+
+        if (!pass.live)
+        {
+            continue;
+        }
+        for (const Pass::Use& use : pass.uses)
+        {
+            if (!use.write)
+            {
+                needed[use.resource] = true;
+            }
+        }
+    }
+}
+
+void RenderGraph::allocateTransients()
+{
+    // lifetimes in pass order, transients only culled passes touch are never created
+    std::vector<uint32_t> firstUse(resources.size(), UINT32_MAX);
+    std::vector<uint32_t> lastUse(resources.size(), 0);
+    for (uint32_t i = 0; i < passes.size(); ++i)
+    {
+        if (!passes[i].live)
+        {
+            continue;
+        }
+        for (const Pass::Use& use : passes[i].uses)
+        {
+            firstUse[use.resource] = std::min(firstUse[use.resource], i);
+            lastUse[use.resource] = std::max(lastUse[use.resource], i);
+        }
+    }
+
+    std::vector<RenderResource> transients;
+    std::vector<VkMemoryRequirements> requirements(resources.size());
+    for (RenderResource i = 0; i < resources.size(); ++i)
+    {
+        Resource& resource = resources[i];
+        if (!resource.transient || firstUse[i] == UINT32_MAX)
+        {
+            continue;
+        }
+
+        VkImageCreateInfo imageInfo{};
+        imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        imageInfo.imageType = VK_IMAGE_TYPE_2D;
+        imageInfo.extent = {resource.info.extent.width, resource.info.extent.height, 1};
+        imageInfo.mipLevels = 1;
+        imageInfo.arrayLayers = 1;
+        imageInfo.format = resource.info.format;
+        imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+        imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        imageInfo.usage = resource.info.usage;
+        imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+        imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+        if (vkCreateImage(device, &imageInfo, nullptr, &resource.imageHandle) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create transient image!");
+        }
+        vkGetImageMemoryRequirements(device, resource.imageHandle, &requirements[i]);
+        transients.push_back(i);
+    }
+
+    // largest first, each goes to the first slot whose occupants are dead by the time it is first used or born after it
+    std::sort(transients.begin(), transients.end(), [&requirements](RenderResource a, RenderResource b)
+    {
+        return requirements[a].size > requirements[b].size;
+    });
+
+    for (RenderResource i : transients)
+    {
+        uint32_t slotIndex = static_cast<uint32_t>(slots.size());
+        for (uint32_t s = 0; s < slots.size(); ++s)
+        {
+            Slot& slot = slots[s];
+            if ((slot.requirements.memoryTypeBits & requirements[i].memoryTypeBits) == 0)
+            {
+                continue;
+            }
+            bool overlaps = std::any_of(slot.resources.begin(), slot.resources.end(), [&](RenderResource other)
+            {
+                return firstUse[i] <= lastUse[other] && firstUse[other] <= lastUse[i];
+            });
+            if (!overlaps)
+            {
+                slotIndex = s;
+                break;
+            }
+        }
+
+        if (slotIndex == slots.size())
+        {
+            Slot slot{};
+            slot.requirements = requirements[i];
+            slots.push_back(slot);
+        }
+
+        Slot& slot = slots[slotIndex];
+        slot.requirements.size = std::max(slot.requirements.size, requirements[i].size);
+        slot.requirements.alignment = std::max(slot.requirements.alignment, requirements[i].alignment);
+        slot.requirements.memoryTypeBits &= requirements[i].memoryTypeBits;
+        slot.resources.push_back(i);
+        resources[i].slot = slotIndex;
+    }
+
+    for (Slot& slot : slots)
+    {
+        slot.memory = allocator->allocate(slot.requirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, ResourceKind::Optimal);
+
+        for (RenderResource i : slot.resources)
+        {
+            Resource& resource = resources[i];
+            vkBindImageMemory(device, resource.imageHandle, slot.memory.memory, slot.memory.offset);
+
+            VkImageViewCreateInfo viewInfo{};
+            viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+            viewInfo.image = resource.imageHandle;
+            viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+            viewInfo.format = resource.info.format;
+            viewInfo.subresourceRange.aspectMask = resource.aspect;
+            viewInfo.subresourceRange.levelCount = 1;
+            viewInfo.subresourceRange.layerCount = 1;
+
+            if (vkCreateImageView(device, &viewInfo, nullptr, &resource.view) != VK_SUCCESS)
+            {
+                throw std::runtime_error("failed to create transient image view!");
+            }
+        }
+    }
+}
+
+void RenderGraph::scheduleBarriers()
+{
+    std::vector<TrackedState> tracked(resources.size());
+    for (RenderResource i = 0; i < resources.size(); ++i)
+    {
+        tracked[i] = initialState(resources[i].before);
+    }
+
+    // an aliased image starts out discarded, after everything its slot held last frame or earlier this one
+    std::vector<TrackedState> slotStates(slots.size());
+    for (const Pass& pass : passes)
+    {
+        for (const Pass::Use& use : pass.uses)
+        {
+            const Resource& resource = resources[use.resource];
+            if (pass.live && resource.transient)
+            {
+                UsageState state = usageState(use.usage);
+                slotStates[resource.slot].writeStages |= state.stages;
+                slotStates[resource.slot].writeAccess |= state.access & WRITE_ACCESS;
+            }
+        }
+    }
+    for (size_t i = 0; i < slots.size(); ++i)
+    {
+        for (RenderResource resource : slots[i].resources)
+        {
+            tracked[resource] = slotStates[i];
+        }
+    }
+
+    auto makeBarrier = [this](RenderResource resource, ResourceUsage usage, const Transition& transition)
+    {
+        UsageState state = usageState(usage);
+
+        Barrier barrier;
+        barrier.resource = resource;
+        barrier.from = transition.from;
+        barrier.to = usage;
+        barrier.srcStages = transition.srcStages;
+        barrier.srcAccess = transition.srcAccess;
+        barrier.dstStages = state.stages;
+        barrier.dstAccess = state.access;
+        barrier.oldLayout = resources[resource].image ? transition.oldLayout : VK_IMAGE_LAYOUT_UNDEFINED;
+        barrier.newLayout = resources[resource].image ? state.layout : VK_IMAGE_LAYOUT_UNDEFINED;
+        return barrier;
+    };
+
+    for (uint32_t i = 0; i < passes.size(); ++i)
+    {
+        if (!passes[i].live)
+        {
+            continue;
+        }
+
+        Step step;
+        step.pass = i;
+        for (const Pass::Use& use : passes[i].uses)
+        {
+            Transition transition = advance(tracked[use.resource], resources[use.resource].image, use.usage, use.write);
+            if (transition.needed)
+            {
+                step.barriers.push_back(makeBarrier(use.resource, use.usage, transition));
+            }
+        }
+        steps.push_back(step);
+    }
+
+    for (RenderResource i = 0; i < resources.size(); ++i)
+    {
+        if (!resources[i].output)
+        {
+            continue;
+        }
+        Transition transition = advance(tracked[i], resources[i].image, resources[i].after, false);
+        if (transition.needed)
+        {
+            finalBarriers.push_back(makeBarrier(i, resources[i].after, transition));
+        }
+    }
+}
+
+void RenderGraph::bindImage(RenderResource resource, VkImage image)
+{
+    resources[resource].imageHandle = image;
+}
+
+void RenderGraph::bindBuffer(RenderResource resource, VkBuffer buffer)
+{
+    resources[resource].bufferHandle = buffer;
+}
+
+VkImage RenderGraph::getImage(RenderResource resource) const
+{
+    return resources[resource].imageHandle;
+}
+
+VkImageView RenderGraph::getImageView(RenderResource resource) const
+{
+    return resources[resource].view;
+}
+
+void RenderGraph::recordBarriers(VkCommandBuffer commandBuffer, const std::vector<Barrier>& barriers) const
+{
+    if (barriers.empty())
+    {
+        return;
+    }
+
+    std::vector<VkImageMemoryBarrier2> imageBarriers;
+    std::vector<VkBufferMemoryBarrier2> bufferBarriers;
+    for (const Barrier& barrier : barriers)
+    {
+        const Resource& resource = resources[barrier.resource];
+        if (resource.image)
+        {
+            VkImageMemoryBarrier2 imageBarrier{};
+            imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2;
+            imageBarrier.srcStageMask = barrier.srcStages;
+            imageBarrier.srcAccessMask = barrier.srcAccess;
+            imageBarrier.dstStageMask = barrier.dstStages;
+            imageBarrier.dstAccessMask = barrier.dstAccess;
+            imageBarrier.oldLayout = barrier.oldLayout;
+            imageBarrier.newLayout = barrier.newLayout;
+            imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            imageBarrier.image = resource.imageHandle;
+            imageBarrier.subresourceRange = {resource.aspect, 0, VK_REMAINING_MIP_LEVELS, 0, VK_REMAINING_ARRAY_LAYERS};
+            imageBarriers.push_back(imageBarrier);
+        }
+        else
+        {
+            VkBufferMemoryBarrier2 bufferBarrier{};
+            bufferBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2;
+            bufferBarrier.srcStageMask = barrier.srcStages;
+            bufferBarrier.srcAccessMask = barrier.srcAccess;
+            bufferBarrier.dstStageMask = barrier.dstStages;
+            bufferBarrier.dstAccessMask = barrier.dstAccess;
+            bufferBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            bufferBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            bufferBarrier.buffer = resource.bufferHandle;
+            bufferBarrier.offset = 0;
+            bufferBarrier.size = VK_WHOLE_SIZE;
+            bufferBarriers.push_back(bufferBarrier);
+        }
+    }
+
+    VkDependencyInfo dependencyInfo{};
+    dependencyInfo.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+    dependencyInfo.bufferMemoryBarrierCount = static_cast<uint32_t>(bufferBarriers.size());
+    dependencyInfo.pBufferMemoryBarriers = bufferBarriers.data();
+    dependencyInfo.imageMemoryBarrierCount = static_cast<uint32_t>(imageBarriers.size());
+    dependencyInfo.pImageMemoryBarriers = imageBarriers.data();
+
+    cmdPipelineBarrier2(commandBuffer, &dependencyInfo);
+}
+
+void RenderGraph::execute(VkCommandBuffer commandBuffer) const
+{
+    for (const Step& step : steps)
+    {
+        recordBarriers(commandBuffer, step.barriers);
+        passes[step.pass].record(commandBuffer);
+    }
+    recordBarriers(commandBuffer, finalBarriers);
+}
+
+std::vector<std::string> RenderGraph::dump() const
+{
+    auto describe = [this](const Barrier& barrier)
+    {
+        std::string line = "    " + resources[barrier.resource].name + ": " + usageState(barrier.from).name + " -> " + usageState(barrier.to).name;
+        if (barrier.oldLayout != barrier.newLayout)
+        {
+            line += std::string(", ") + layoutName(barrier.oldLayout) + " -> " + layoutName(barrier.newLayout);
+        }
+        return line;
+    };
+
+    size_t barrierCount = finalBarriers.size();
+    size_t batchCount = finalBarriers.empty() ? 0 : 1;
+    for (const Step& step : steps)
+    {
+        barrierCount += step.barriers.size();
+        batchCount += step.barriers.empty() ? 0 : 1;
+    }
+
+    std::vector<std::string> lines;
+    lines.push_back("render graph: " + std::to_string(steps.size()) + " of " + std::to_string(passes.size()) + " passes live, " +
+        std::to_string(barrierCount) + " barriers in " + std::to_string(batchCount) + " batches, " + std::to_string(slots.size()) + " transient memory slots");
+
+    size_t nextStep = 0;
+    for (uint32_t i = 0; i < passes.size(); ++i)
+    {
+        if (!passes[i].live)
+        {
+            lines.push_back("  pass " + passes[i].name + ": culled, nothing reads its output");
+            continue;
+        }
+
+        const Step& step = steps[nextStep++];
+        lines.push_back("  pass " + passes[i].name + ": " + std::to_string(step.barriers.size()) + " barriers");
+        for (const Barrier& barrier : step.barriers)
+        {
+            lines.push_back(describe(barrier));
+        }
+    }
+
+    lines.push_back("  end of graph: " + std::to_string(finalBarriers.size()) + " barriers");
+    for (const Barrier& barrier : finalBarriers)
+    {
+        lines.push_back(describe(barrier));
+    }
+
+    for (size_t i = 0; i < slots.size(); ++i)
+    {
+        char size[32];
+        snprintf(size, sizeof(size), "%.2f MiB", slots[i].requirements.size / (1024.0 * 1024.0));
+        std::string line = "  memory slot " + std::to_string(i) + ": " + size + ",";
+        for (RenderResource resource : slots[i].resources)
+        {
+            line += " " + resources[resource].name;
+        }
+        lines.push_back(line);
+    }
+
+    return lines;
+}
+
+void RenderGraph::retire(DeletionQueue& deletionQueue, uint64_t frame)
+{
+    for (Resource& resource : resources)
+    {
+        if (resource.transient && resource.imageHandle != VK_NULL_HANDLE)
+        {
+            deletionQueue.retireImageView(frame, resource.view);
+            // the memory belongs to the slot
+            deletionQueue.retireImage(frame, resource.imageHandle, MemoryAllocation{});
+        }
+    }
+
+    // queued after the images, so they are gone before their memory is released
+    MemoryAllocator* memoryAllocator = allocator;
+    for (Slot& slot : slots)
+    {
+        MemoryAllocation memory = slot.memory;
+        deletionQueue.retire(frame, [memoryAllocator, memory]() mutable
+        {
+            memoryAllocator->free(memory);
+        });
+    }
+
+    resources.clear();
+    passes.clear();
+    steps.clear();
+    finalBarriers.clear();
+    slots.clear();
+}
\ No newline at end of file
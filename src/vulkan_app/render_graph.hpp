@@ -0,0 +1,162 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <deque>
+#include <functional>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include "memory_allocator.hpp"
+#include "deletion_queue.hpp"
+
+using RenderResource = uint32_t;
+
+// how a pass touches a resource, each use implies its stages, accesses and image layout
+enum class ResourceUsage
+{
+    // no earlier gpu use to wait for
+    None,
+    // swapchain image, the acquire semaphore is waited on at color attachment output
+    Acquired,
+    IndirectRead,
+    ComputeRead,
+    ComputeWrite,
+    FragmentSampled,
+    ColorAttachment,
+    DepthAttachment,
+    TransferRead,
+    TransferWrite,
+    HostRead,
+    Present
+};
+
+// image owned by the graph, its memory is shared with transients whose lifetimes do not overlap
+struct TransientImageInfo
+{
+    VkFormat format;
+    VkExtent2D extent;
+    VkImageUsageFlags usage;
+    VkImageAspectFlags aspect;
+};
+
+// passes declare what they read and write, compile() culls the passes nothing depends on,
+// infers the barriers between the rest and aliases the memory of transient images
+class RenderGraph
+{
+public:
+    class Pass
+    {
+    public:
+        Pass& read(RenderResource resource, ResourceUsage usage);
+        Pass& write(RenderResource resource, ResourceUsage usage);
+        // never culled, like a pass that only feeds the host
+        Pass& keep();
+
+    private:
+        friend class RenderGraph;
+
+        struct Use
+        {
+            RenderResource resource;
+            ResourceUsage usage;
+            bool write;
+        };
+
+        std::string name;
+        std::function<void(VkCommandBuffer)> record;
+        std::vector<Use> uses;
+        bool sideEffects = false;
+        bool live = false;
+    };
+
+    void init(VkDevice device, MemoryAllocator* allocator, PFN_vkCmdPipelineBarrier2KHR cmdPipelineBarrier2);
+
+    RenderResource importImage(const std::string& name, VkImageAspectFlags aspect, ResourceUsage before);
+    RenderResource importBuffer(const std::string& name, ResourceUsage before);
+    RenderResource createImage(const std::string& name, const TransientImageInfo& info);
+    // passes run in the order they are added
+    Pass& addPass(const std::string& name, std::function<void(VkCommandBuffer)> record);
+    // keeps the producers of the resource and leaves it in the given use once the graph ran
+    void output(RenderResource resource, ResourceUsage after);
+
+    void compile();
+
+    // imported handles may change every frame, like the acquired swapchain image
+    void bindImage(RenderResource resource, VkImage image);
+    void bindBuffer(RenderResource resource, VkBuffer buffer);
+    VkImage getImage(RenderResource resource) const;
+    VkImageView getImageView(RenderResource resource) const;
+
+    void execute(VkCommandBuffer commandBuffer) const;
+
+    // compiled schedule, one line per pass, barrier and memory slot
+    std::vector<std::string> dump() const;
+
+    // hands the transient images to the deletion queue, the graph can be rebuilt right away
+    void retire(DeletionQueue& deletionQueue, uint64_t frame);
+
+private:
+    struct Resource
+    {
+        std::string name;
+        bool image = false;
+        bool transient = false;
+        VkImageAspectFlags aspect = 0;
+        ResourceUsage before = ResourceUsage::None;
+        ResourceUsage after = ResourceUsage::None;
+        bool output = false;
+
+        VkImage imageHandle = VK_NULL_HANDLE;
+        VkImageView view = VK_NULL_HANDLE;
+        VkBuffer bufferHandle = VK_NULL_HANDLE;
+
+        TransientImageInfo info{};
+        uint32_t slot = 0;
+    };
+
+    struct Barrier
+    {
+        RenderResource resource;
+        ResourceUsage from;
+        ResourceUsage to;
+        VkPipelineStageFlags2 srcStages;
+        VkAccessFlags2 srcAccess;
+        VkPipelineStageFlags2 dstStages;
+        VkAccessFlags2 dstAccess;
+        VkImageLayout oldLayout;
+        VkImageLayout newLayout;
+    };
+
+    // the barriers recorded ahead of one pass, all in a single call
+    struct Step
+    {
+        uint32_t pass;
+        std::vector<Barrier> barriers;
+    };
+
+    struct Slot
+    {
+        MemoryAllocation memory;
+        VkMemoryRequirements requirements;
+        std::vector<RenderResource> resources;
+    };
+
+    void cullPasses();
+    void scheduleBarriers();
+    void allocateTransients();
+    void recordBarriers(VkCommandBuffer commandBuffer, const std::vector<Barrier>& barriers) const;
+
+    VkDevice device = VK_NULL_HANDLE;
+    MemoryAllocator* allocator = nullptr;
+    PFN_vkCmdPipelineBarrier2KHR cmdPipelineBarrier2 = nullptr;
+
+    std::vector<Resource> resources;
+    // stable addresses, addPass hands out references
+    std::deque<Pass> passes;
+
+    std::vector<Step> steps;
+    std::vector<Barrier> finalBarriers;
+    std::vector<Slot> slots;
+};
\ No newline at end of file
@@ -0,0 +1,136 @@
+#include "shader_variants.hpp"
+
+#include <SDL2/SDL.h>
+
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+static const char* const MANIFEST_NAME = "variants.manifest";
+
+// 0 for names the application has no feature for
+static uint32_t findFeature(const std::string& name)
+{
+    for (uint32_t i = 0; i < sizeof(SHADER_FEATURE_NAMES) / sizeof(SHADER_FEATURE_NAMES[0]); ++i)
+    {
+        if (name == SHADER_FEATURE_NAMES[i])
+        {
+            return 1u << i;
+        }
+    }
+    return 0;
+}
+
+VkSpecializationInfo ShaderVariant::getSpecializationInfo() const
+{
+    VkSpecializationInfo info{};
+    info.mapEntryCount = static_cast<uint32_t>(mapEntries.size());
+    info.pMapEntries = mapEntries.data();
+    info.dataSize = values.size() * sizeof(VkBool32);
+    info.pData = values.data();
+    return info;
+}
+
+bool ShaderVariants::load(const std::string& directory)
+{
+    this->directory = directory;
+    shaders.clear();
+    variantCount = 0;
+
+    std::ifstream file(directory + MANIFEST_NAME);
+    if (!file.is_open())
+    {
+        return false;
+    }
+
+    // "variant <shader> <spirv> [defines...]" and "specialization <shader> <name> <constant id>"
+    std::string line;
+    while (std::getline(file, line))
+    {
+        std::istringstream words(line);
+        std::string kind, shaderName;
+        if (!(words >> kind >> shaderName))
+        {
+            continue;
+        }
+
+        if (kind == "variant")
+        {
+            std::string spirv, define;
+            words >> spirv;
+
+            uint32_t features = 0;
+            bool known = true;
+            while (words >> define)
+            {
+                uint32_t feature = findFeature(define);
+                if (feature == 0)
+                {
+                    SDL_Log("shader variant %s is built with %s, which no feature selects", spirv.c_str(), define.c_str());
+                    known = false;
+                }
+                features |= feature;
+            }
+            if (!known)
+            {
+                continue;
+            }
+
+            Shader& shader = shaders[shaderName];
+            shader.definedFeatures |= features;
+            shader.files[features] = spirv;
+            ++variantCount;
+        }
+        else if (kind == "specialization")
+        {
+            std::string name;
+            uint32_t constantId;
+            if (!(words >> name >> constantId))
+            {
+                continue;
+            }
+
+            uint32_t feature = findFeature(name);
+            if (feature == 0)
+            {
+                SDL_Log("specialization constant %s of %s matches no feature, it keeps its default", name.c_str(), shaderName.c_str());
+                continue;
+            }
+            shaders[shaderName].constants.push_back({feature, constantId});
+        }
+    }
+
+    return true;
+}
+
+ShaderVariant ShaderVariants::select(const std::string& shaderName, uint32_t features) const
+{
+    ShaderVariant variant;
+
+    auto found = shaders.find(shaderName);
+    if (found == shaders.end())
+    {
+        variant.path = directory + shaderName + ".spv";
+        return variant;
+    }
+
+    const Shader& shader = found->second;
+    auto file = shader.files.find(features & shader.definedFeatures);
+    if (file == shader.files.end())
+    {
+        throw std::runtime_error("failed to find shader variant for " + shaderName + "!");
+    }
+    variant.path = directory + file->second;
+
+    for (const auto& [feature, constantId] : shader.constants)
+    {
+        VkSpecializationMapEntry entry{};
+        entry.constantID = constantId;
+        entry.offset = static_cast<uint32_t>(variant.values.size() * sizeof(VkBool32));
+        entry.size = sizeof(VkBool32);
+        variant.mapEntries.push_back(entry);
+        variant.values.push_back((features & feature) != 0 ? VK_TRUE : VK_FALSE);
+    }
+
+    return variant;
+}
\ No newline at end of file
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <cstdint>
+
+// features pipelines pick shader variants by, bit i is called SHADER_FEATURE_NAMES[i] in the shaders
+enum ShaderFeature : uint32_t
+{
+    SHADER_FEATURE_TEXTURED = 1 << 0,
+    SHADER_FEATURE_ALPHA_TEST = 1 << 1
+};
+
+const char* const SHADER_FEATURE_NAMES[] = {"TEXTURED", "ALPHA_TEST"};
+
+// the SPIR-V of one stage and the specialization constants it is created with
+struct ShaderVariant
+{
+    std::string path;
+    std::vector<VkSpecializationMapEntry> mapEntries;
+    std::vector<VkBool32> values;
+
+    // points into the variant, which has to outlive the pipeline creation
+    VkSpecializationInfo getSpecializationInfo() const;
+};
+
+// the permutations the shaders target compiled, read from the manifest it writes next to the SPIR-V
+class ShaderVariants
+{
+public:
+    // false without a manifest, every shader is then <name>.spv without specialization
+    bool load(const std::string& directory);
+
+    // the SPIR-V compiled with the defines among the features, the constants among them are specialized;
+    // features the shader does not declare are ignored
+    ShaderVariant select(const std::string& shader, uint32_t features) const;
+
+    uint32_t getVariantCount() const { return variantCount; }
+
+private:
+    struct Shader
+    {
+        // features compiled in as defines, and a file for every combination of them
+        uint32_t definedFeatures = 0;
+        std::unordered_map<uint32_t, std::string> files;
+        // feature bit and constant id
+        std::vector<std::pair<uint32_t, uint32_t>> constants;
+    };
+
+    std::string directory;
+    std::unordered_map<std::string, Shader> shaders;
+    uint32_t variantCount = 0;
+};
\ No newline at end of file
@@ -126,7 +126,8 @@ void VulkanApp::createSwapChain()
     createInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
     createInfo.presentMode = presentMode;
     createInfo.clipped = VK_TRUE;
-    createInfo.oldSwapchain = VK_NULL_HANDLE;
+    // the old swapchain hands its resources over and stays valid for the images it already presented
+    createInfo.oldSwapchain = swapChain;
 
     //_putenv("DISABLE_VK_LAYER_VALVE_steam_overlay_1=1"); // steam overlay causes troubles sometimes
 
@@ -144,14 +145,25 @@ void VulkanApp::createSwapChain()
 
 void VulkanApp::recreateSwapChain()
 {
-    vkDeviceWaitIdle(device);
+    int width, height;
+    SDL_Vulkan_GetDrawableSize(window, &width, &height);
+    if (width == 0 || height == 0)
+    {
+        framebufferResized = true;
+        return;
+    }
+    framebufferResized = false;
 
+    // nothing waits for the device, the old swapchain is retired along with the frames still using it
     cleanupSwapChain();
 
     createSwapChain();
     createImageViews();
-    createDepthResources();
+    createRenderGraph();
     createFramebuffers();
+    invalidateCommandBuffers();
+
+    SDL_Log("swapchain recreated at %ux%u", swapChainExtent.width, swapChainExtent.height);
 }
 
 void VulkanApp::createImageViews()
@@ -183,19 +195,26 @@ void VulkanApp::createImageViews()
 
 void VulkanApp::cleanupSwapChain()
 {
-    vkDestroyImageView(device, depthImageView, nullptr);
-    vkDestroyImage(device, depthImage, nullptr);
-    vkFreeMemory(device, depthImageMemory, nullptr);
+    // the last submitted frame is the last one that could have rendered to them
+    uint64_t lastUse = frameScheduler.lastSubmittedFrame();
+
+    renderGraph.retire(deletionQueue, lastUse);
 
     for (size_t i = 0; i < swapChainFramebuffers.size(); ++i)
     {
-        vkDestroyFramebuffer(device, swapChainFramebuffers[i], nullptr);
+        deletionQueue.retireFramebuffer(lastUse, swapChainFramebuffers[i]);
     }
 
     for (size_t i = 0; i < swapChainImageViews.size(); ++i)
     {
-        vkDestroyImageView(device, swapChainImageViews[i], nullptr);
+        deletionQueue.retireImageView(lastUse, swapChainImageViews[i]);
     }
 
-    vkDestroySwapchainKHR(device, swapChain, nullptr);
+    // presents are not tracked by the timeline, once as many frames as can be in flight retired
+    // after the last one, its images are off screen; the handle stays set for createSwapChain
+    VkSwapchainKHR retiredSwapChain = swapChain;
+    deletionQueue.retire(lastUse + framesInFlight, [this, retiredSwapChain]()
+    {
+        vkDestroySwapchainKHR(device, retiredSwapChain, nullptr);
+    });
 }
\ No newline at end of file
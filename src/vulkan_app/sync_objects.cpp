@@ -2,24 +2,47 @@
 
 void VulkanApp::createSyncObjects()
 {
-    imageAvailableSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-    renderFinishedSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-    inFlightFences.resize(MAX_FRAMES_IN_FLIGHT);
+    imageAvailableSemaphores.resize(framesInFlight);
+    renderFinishedSemaphores.resize(framesInFlight);
 
     VkSemaphoreCreateInfo semaphoreInfo{};
     semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
 
-    VkFenceCreateInfo fenceInfo{};
-    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-    fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
-
-    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i)
+    for (size_t i = 0; i < framesInFlight; ++i)
     {
         if (vkCreateSemaphore(device, &semaphoreInfo, nullptr, &imageAvailableSemaphores[i]) != VK_SUCCESS ||
-            vkCreateSemaphore(device, &semaphoreInfo, nullptr, &renderFinishedSemaphores[i]) != VK_SUCCESS ||
-            vkCreateFence(device, &fenceInfo, nullptr, &inFlightFences[i]) != VK_SUCCESS)
+            vkCreateSemaphore(device, &semaphoreInfo, nullptr, &renderFinishedSemaphores[i]) != VK_SUCCESS)
         {
             throw std::runtime_error("failed to create semaphores!");
         }
     }
+
+    // replaces the per-frame fences, anything can ask whether a frame retired
+    frameScheduler.init(device, framesInFlight);
+
+    SDL_Log("%u frames in flight", framesInFlight);
+}
+
+void VulkanApp::reportFrameStats()
+{
+    float time = getTime();
+    if (time - lastFrameReport < 1.f)
+    {
+        return;
+    }
+    lastFrameReport = time;
+
+    // deeper queues raise throughput when the cpu and gpu take turns, at the cost of latency
+    FrameStats stats = frameScheduler.takeStats();
+    if (stats.frameCount == 0)
+    {
+        return;
+    }
+    SDL_Log("frames: %.1f fps, %.3f ms waiting for a frame slot per frame, %.2f ms submit to retire, "
+        "%.3f ms recording per frame, %u command buffers recorded, %.1f KiB of uniforms per frame at most",
+        stats.frameCount / stats.seconds, stats.waitMilliseconds / stats.frameCount,
+        stats.latencySamples > 0 ? stats.latencyMilliseconds / stats.latencySamples : 0.0,
+        recordMilliseconds / stats.frameCount, recordedCommandBuffers, uniformRing.takePeakBytes() / 1024.f);
+    recordMilliseconds = 0.0;
+    recordedCommandBuffers = 0;
 }
\ No newline at end of file
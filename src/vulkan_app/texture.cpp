@@ -1,7 +1,9 @@
 #include "vulkan_app.hpp"
 #include "stb_image.h"
+#include "ktx2.hpp"
+#include "mapped_file.hpp"
 
-void VulkanApp::createImage(CustomImageCreateInfo& customImageInfo, VkImage& image, VkDeviceMemory& imageMemory)
+void VulkanApp::createImage(CustomImageCreateInfo& customImageInfo, VkImage& image, MemoryAllocation& imageMemory)
 {
     VkImageCreateInfo imageInfo{};
     imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
@@ -29,26 +31,17 @@ void VulkanApp::createImage(CustomImageCreateInfo& customImageInfo, VkImage& ima
     VkMemoryRequirements memRequirements;
     vkGetImageMemoryRequirements(device, image, &memRequirements);
 
-    VkMemoryAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    allocInfo.allocationSize = memRequirements.size;
-    allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, customImageInfo.properties);
+    ResourceKind kind = customImageInfo.tiling == VK_IMAGE_TILING_LINEAR ? ResourceKind::Linear : ResourceKind::Optimal;
+    imageMemory = memoryAllocator.allocate(memRequirements, customImageInfo.properties, kind);
 
-    if (vkAllocateMemory(device, &allocInfo, nullptr, &imageMemory) != VK_SUCCESS)
-    {
-        throw std::runtime_error("failed to allocate image memory!");
-    }
-
-    vkBindImageMemory(device, image, imageMemory, 0);
+    vkBindImageMemory(device, image, imageMemory.memory, imageMemory.offset);
 
 }
 
-void VulkanApp::copyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height)
+void VulkanApp::copyBufferToImage(VkBuffer buffer, VkDeviceSize bufferOffset, VkImage image, uint32_t width, uint32_t height)
 {
-    VkCommandBuffer commandBuffer = beginSingleTimeCommands(transferCommandPool);
-
     VkBufferImageCopy region{};
-    region.bufferOffset = 0;
+    region.bufferOffset = bufferOffset;
     region.bufferRowLength = 0;
     region.bufferImageHeight = 0;
     region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
@@ -62,108 +55,191 @@ void VulkanApp::copyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width
         1
     };
 
+    copyBufferToImage(buffer, image, std::vector<VkBufferImageCopy>{region});
+}
+
+void VulkanApp::copyBufferToImage(VkBuffer buffer, VkImage image, const std::vector<VkBufferImageCopy>& regions)
+{
     vkCmdCopyBufferToImage(
-        commandBuffer,
+        transferUploads.commandBuffer(),
         buffer,
         image,
         VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-        1,
-        &region
+        static_cast<uint32_t>(regions.size()),
+        regions.data()
     );
 
-    endSingleTimeCommands(transferCommandPool, commandBuffer, transferQueue);
+    transferUploads.endOperation();
 }
 
-void VulkanApp::generateMipmaps(VkImage image, VkFormat imageFormat, int32_t texWidth, int32_t texHeight, uint32_t mipLevels)
+void VulkanApp::generateMipmaps(UploadContext& uploads, const std::vector<MipChain>& chains)
 {
-    VkFormatProperties formatProperties;
-    vkGetPhysicalDeviceFormatProperties(physicalDevice, imageFormat, &formatProperties);
-    if (!(formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT))
+    uint32_t maxLevels = 0;
+    for (const MipChain& chain : chains)
     {
-        throw std::runtime_error("texture image format does not support linear blitting!");
+        VkFormatProperties formatProperties;
+        vkGetPhysicalDeviceFormatProperties(physicalDevice, chain.format, &formatProperties);
+        if (!(formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT))
+        {
+            throw std::runtime_error("texture image format does not support linear blitting!");
+        }
+
+        maxLevels = std::max(maxLevels, chain.levels);
     }
 
-    VkCommandBuffer commandBuffer = beginSingleTimeCommands(graphicsCommandPool);
+    // the acquires are recorded before any level changes layout
+    VkCommandBuffer commandBuffer = uploads.commandBuffer();
 
-    VkImageMemoryBarrier barrier{};
-    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-    barrier.image = image;
-    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-    barrier.subresourceRange.baseArrayLayer = 0;
-    barrier.subresourceRange.layerCount = 1;
-    barrier.subresourceRange.levelCount = 1;
+    // level by level across all chains, one barrier batch ahead of the blits of each level: it turns the
+    // previous level into the blit source and hands the one before it, now finished, to the fragment shader
+    for (uint32_t level = 1; level <= maxLevels; ++level)
+    {
+        BarrierBatch& barriers = uploads.barriers();
+        for (const MipChain& chain : chains)
+        {
+            if (level >= 2 && level - 1 < chain.levels)
+            {
+                barriers.image(chain.image, level - 2, 1, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                    VK_PIPELINE_STAGE_2_BLIT_BIT, VK_ACCESS_2_NONE, VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT, VK_ACCESS_2_SHADER_SAMPLED_READ_BIT);
+            }
+
+            if (level < chain.levels)
+            {
+                barriers.image(chain.image, level - 1, 1, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                    VK_PIPELINE_STAGE_2_BLIT_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_2_BLIT_BIT, VK_ACCESS_2_TRANSFER_READ_BIT);
+            }
+            else if (level == chain.levels)
+            {
+                // the last level is never blitted from
+                barriers.image(chain.image, level - 1, 1, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                    VK_PIPELINE_STAGE_2_BLIT_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT, VK_ACCESS_2_SHADER_SAMPLED_READ_BIT);
+            }
+        }
+        barriers.flush(commandBuffer);
 
-    int32_t mipWidth = texWidth;
-    int32_t mipHeight = texHeight;
+        for (const MipChain& chain : chains)
+        {
+            if (level >= chain.levels)
+            {
+                continue;
+            }
+
+            int32_t srcWidth = std::max(chain.width >> (level - 1), 1);
+            int32_t srcHeight = std::max(chain.height >> (level - 1), 1);
+
+            VkImageBlit blit{};
+            blit.srcOffsets[0] = {0, 0, 0};
+            blit.srcOffsets[1] = {srcWidth, srcHeight, 1};
+            blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            blit.srcSubresource.mipLevel = level - 1;
+            blit.srcSubresource.baseArrayLayer = 0;
+            blit.srcSubresource.layerCount = 1;
+            blit.dstOffsets[0] = {0, 0, 0};
+            blit.dstOffsets[1] = {srcWidth > 1 ? srcWidth / 2 : 1, srcHeight > 1 ? srcHeight / 2 : 1, 1};
+            blit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            blit.dstSubresource.mipLevel = level;
+            blit.dstSubresource.baseArrayLayer = 0;
+            blit.dstSubresource.layerCount = 1;
+
+            vkCmdBlitImage(commandBuffer,
+                chain.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                chain.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                1, &blit,
+                VK_FILTER_LINEAR);
+        }
+    }
+}
 
-    for (uint32_t i = 1; i < mipLevels; ++i)
+bool VulkanApp::loadCookedTexture()
+{
+    MappedFile file;
+    if (!file.open(COOKED_TEXTURE_PATH))
     {
-        barrier.subresourceRange.baseMipLevel = i - 1;
-        barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-        barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
-        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-        barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
-
-        vkCmdPipelineBarrier(commandBuffer,
-            VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
-            0, nullptr,
-            0, nullptr,
-            1, &barrier);
-
-        VkImageBlit blit{};
-        blit.srcOffsets[0] = {0, 0, 0};
-        blit.srcOffsets[1] = {mipWidth, mipHeight, 1};
-        blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-        blit.srcSubresource.mipLevel = i - 1;
-        blit.srcSubresource.baseArrayLayer = 0;
-        blit.srcSubresource.layerCount = 1;
-        blit.dstOffsets[0] = {0, 0, 0};
-        blit.dstOffsets[1] = {mipWidth > 1 ? mipWidth / 2 : 1, mipHeight > 1 ? mipHeight / 2 : 1, 1};
-        blit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-        blit.dstSubresource.mipLevel = i;
-        blit.dstSubresource.baseArrayLayer = 0;
-        blit.dstSubresource.layerCount = 1;
-
-        vkCmdBlitImage(commandBuffer,
-            image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
-            image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-            1, &blit,
-            VK_FILTER_LINEAR);
-
-        barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
-        barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-        barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
-        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-
-        vkCmdPipelineBarrier(commandBuffer,
-            VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
-            0, nullptr,
-            0, nullptr,
-            1, &barrier);
-        
-        if (mipWidth > 1) mipWidth /= 2;
-        if (mipHeight > 1) mipHeight /= 2;
+        return false;
     }
 
-    barrier.subresourceRange.baseMipLevel = mipLevels - 1;
-    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-    barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    Ktx2Texture texture;
+    if (!parseKtx2(file.data(), file.size(), texture))
+    {
+        SDL_Log("%s is not a texture this loader understands, decoding the source image", COOKED_TEXTURE_PATH.c_str());
+        return false;
+    }
+
+    VkFormatProperties formatProperties;
+    vkGetPhysicalDeviceFormatProperties(physicalDevice, texture.format, &formatProperties);
+    bool formatSupported = !isBlockCompressed(texture.format) || textureCompressionBCSupported;
+    if (!formatSupported || !(formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT))
+    {
+        SDL_Log("format of %s is not supported by the device, decoding the source image", COOKED_TEXTURE_PATH.c_str());
+        return false;
+    }
+
+    // every level goes into one staging range and is copied with one region each
+    VkDeviceSize imageSize = 0;
+    std::vector<VkBufferImageCopy> regions(texture.levels.size());
+    for (size_t i = 0; i < texture.levels.size(); ++i)
+    {
+        const TextureLevel& level = texture.levels[i];
+        regions[i].bufferOffset = imageSize;
+        regions[i].imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        regions[i].imageSubresource.mipLevel = static_cast<uint32_t>(i);
+        regions[i].imageSubresource.baseArrayLayer = 0;
+        regions[i].imageSubresource.layerCount = 1;
+        regions[i].imageOffset = {0, 0, 0};
+        regions[i].imageExtent = {level.width, level.height, 1};
+
+        // offsets of block-compressed levels stay multiples of the block size
+        imageSize += (level.size + 15) & ~static_cast<VkDeviceSize>(15);
+    }
+
+    textureFormat = texture.format;
+    mipLevels = static_cast<uint32_t>(texture.levels.size());
+
+    CustomImageCreateInfo customImageInfo{};
+    customImageInfo.imageType = VK_IMAGE_TYPE_2D;
+    customImageInfo.width = texture.width;
+    customImageInfo.height = texture.height;
+    customImageInfo.format = textureFormat;
+    customImageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    customImageInfo.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+    customImageInfo.properties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+    customImageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    customImageInfo.mipLevels = mipLevels;
+
+    createImage(customImageInfo, textureImage, textureImageMemory);
+
+    // the mips are precomputed, no blits needed
+    transitionImageLayout(transferUploads, textureImage, textureFormat, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, mipLevels);
+
+    // staged only now so the range is copied out by the batch it was taken from
+    StagingAllocation staging = transferUploads.stage(imageSize);
+    for (size_t i = 0; i < texture.levels.size(); ++i)
+    {
+        memcpy(static_cast<uint8_t*>(staging.mapped) + regions[i].bufferOffset, texture.levels[i].data, texture.levels[i].size);
+        regions[i].bufferOffset += staging.offset;
+    }
+    copyBufferToImage(staging.buffer, textureImage, regions);
+    releaseImage(textureImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, mipLevels,
+        VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT, VK_ACCESS_2_SHADER_SAMPLED_READ_BIT);
+    transferUploads.endOperation();
 
-    vkCmdPipelineBarrier(commandBuffer,
-        VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
-        0, nullptr,
-        0, nullptr,
-        1, &barrier);
+    size_t textureSize = 0;
+    for (const auto& level : texture.levels)
+    {
+        textureSize += level.size;
+    }
+    SDL_Log("texture %s: %ux%u, %u levels, %.1f KiB", COOKED_TEXTURE_PATH.c_str(), texture.width, texture.height, mipLevels, textureSize / 1024.f);
 
-    endSingleTimeCommands(graphicsCommandPool, commandBuffer, graphicsQueue);
+    return true;
 }
 
 void VulkanApp::createTextureImage()
 {
+    if (loadCookedTexture())
+    {
+        return;
+    }
+
     int texWidth, texHeight, texChannels;
     stbi_uc* pixels = stbi_load(TEXTURE_PATH.c_str(), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
     VkDeviceSize imageSize = texWidth * texHeight * 4;
@@ -174,29 +250,6 @@ void VulkanApp::createTextureImage()
         throw std::runtime_error("failed to load texture image!");
     }
 
-    QueueFamilyIndices familyIndices = findQueueFamilies(physicalDevice);
-    uint32_t queueFamilyIndices[] = {familyIndices.graphicsFamily.value(), familyIndices.transferFamily.value()};
-
-    VkBuffer stagingBuffer;
-    VkDeviceMemory stagingBufferMemory;
-
-    CustomBufferCreateInfo customBufferInfo{};
-    customBufferInfo.size = imageSize;
-    customBufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
-    customBufferInfo.properties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
-    customBufferInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
-    customBufferInfo.queueFamilyIndexCount = 2;
-    customBufferInfo.pQueueFamilyIndices = queueFamilyIndices;
-
-    createBuffer(customBufferInfo, stagingBuffer, stagingBufferMemory);
-
-    void* data;
-    vkMapMemory(device, stagingBufferMemory, 0, imageSize, 0, &data);
-    memcpy(data, pixels, static_cast<size_t>(imageSize));
-    vkUnmapMemory(device, stagingBufferMemory);
-
-    stbi_image_free(pixels);
-
     CustomImageCreateInfo customImageInfo{};
     customImageInfo.imageType = VK_IMAGE_TYPE_2D;
     customImageInfo.width = texWidth;
@@ -205,112 +258,62 @@ void VulkanApp::createTextureImage()
     customImageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
     customImageInfo.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
     customImageInfo.properties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
-    customImageInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
-    customImageInfo.queueFamilyIndexCount = 2;
-    customImageInfo.pQueueFamilyIndices = queueFamilyIndices;
+    customImageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
     customImageInfo.mipLevels = mipLevels;
 
     createImage(customImageInfo, textureImage, textureImageMemory);
 
-    transitionImageLayout(textureImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, mipLevels);
-    copyBufferToImage(stagingBuffer, textureImage, static_cast<uint32_t>(texWidth), static_cast<uint32_t>(texHeight));
-    //transitionImageLayout(textureImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, mipLevels);
-    generateMipmaps(textureImage, VK_FORMAT_R8G8B8A8_SRGB, texWidth, texHeight, mipLevels);
+    transitionImageLayout(transferUploads, textureImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, mipLevels);
 
-    vkDestroyBuffer(device, stagingBuffer, nullptr);
-    vkFreeMemory(device, stagingBufferMemory, nullptr);
-}
+    StagingAllocation staging = transferUploads.stage(imageSize);
+    memcpy(staging.mapped, pixels, static_cast<size_t>(imageSize));
 
-static bool hasStencilComponent(VkFormat format)
-{
-    return format == VK_FORMAT_D32_SFLOAT_S8_UINT || format == VK_FORMAT_D24_UNORM_S8_UINT;
-}
+    stbi_image_free(pixels);
 
-void VulkanApp::transitionImageLayout(VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout, uint32_t mipLevels)
-{
-    VkCommandPool commandPool;
-    VkQueue queue;
-    if (newLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL)
-    {
-        commandPool = transferCommandPool;
-        queue = transferQueue;
-    }
-    else
-    {
-        commandPool = graphicsCommandPool;
-        queue = graphicsQueue;
-    }
+    copyBufferToImage(staging.buffer, staging.offset, textureImage, static_cast<uint32_t>(texWidth), static_cast<uint32_t>(texHeight));
 
-    VkCommandBuffer commandBuffer = beginSingleTimeCommands(commandPool);
-
-    VkImageMemoryBarrier barrier{};
-    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-    barrier.oldLayout = oldLayout;
-    barrier.newLayout = newLayout;
-    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-    barrier.image = image;
-    barrier.subresourceRange.baseMipLevel = 0;
-    barrier.subresourceRange.levelCount = mipLevels;
-    barrier.subresourceRange.baseArrayLayer = 0;
-    barrier.subresourceRange.layerCount = 1;
-    
-    if (newLayout == VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL)
-    {
-        barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+    // the transfer queue cannot blit, the graphics queue builds the mips right after acquiring the image
+    releaseImage(textureImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, mipLevels,
+        VK_PIPELINE_STAGE_2_BLIT_BIT, VK_ACCESS_2_TRANSFER_READ_BIT | VK_ACCESS_2_TRANSFER_WRITE_BIT);
+    generateMipmapsOnAcquire({textureImage, VK_FORMAT_R8G8B8A8_SRGB, texWidth, texHeight, mipLevels});
+    transferUploads.endOperation();
 
-        if (hasStencilComponent(format))
-        {
-            barrier.subresourceRange.aspectMask |= VK_IMAGE_ASPECT_STENCIL_BIT;
-        }
-    } 
-    else
+    size_t textureSize = 0;
+    for (uint32_t i = 0; i < mipLevels; ++i)
     {
-        barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        textureSize += static_cast<size_t>(std::max(texWidth >> i, 1)) * std::max(texHeight >> i, 1) * 4;
     }
-    
-    VkPipelineStageFlags sourceStage;
-    VkPipelineStageFlags destinationStage;
+    SDL_Log("texture %s: %dx%d, %u levels, %.1f KiB", TEXTURE_PATH.c_str(), texWidth, texHeight, mipLevels, textureSize / 1024.f);
+}
+
+void VulkanApp::transitionImageLayout(UploadContext& uploads, VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout, uint32_t mipLevels)
+{
+    VkPipelineStageFlags2 srcStage;
+    VkAccessFlags2 srcAccess;
+    VkPipelineStageFlags2 dstStage;
+    VkAccessFlags2 dstAccess;
 
     if (oldLayout == VK_IMAGE_LAYOUT_UNDEFINED && newLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL)
     {
-        barrier.srcAccessMask = 0;
-        barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-
-        sourceStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
-        destinationStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+        srcStage = VK_PIPELINE_STAGE_2_NONE;
+        srcAccess = VK_ACCESS_2_NONE;
+        dstStage = VK_PIPELINE_STAGE_2_COPY_BIT;
+        dstAccess = VK_ACCESS_2_TRANSFER_WRITE_BIT;
     }
     else if (oldLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL && newLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL)
     {
-        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-
-        sourceStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-        destinationStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
-    } 
-    else if (oldLayout == VK_IMAGE_LAYOUT_UNDEFINED && newLayout == VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL)
-    {
-        barrier.srcAccessMask = 0;
-        barrier.dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
-
-        sourceStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
-        destinationStage = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+        srcStage = VK_PIPELINE_STAGE_2_COPY_BIT;
+        srcAccess = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+        dstStage = VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT;
+        dstAccess = VK_ACCESS_2_SHADER_SAMPLED_READ_BIT;
     }
     else
     {
         throw std::invalid_argument("unsupported layout transition!");
     }
 
-    vkCmdPipelineBarrier(
-        commandBuffer,
-        sourceStage, destinationStage,
-        0,
-        0, nullptr,
-        0, nullptr,
-        1, &barrier
-    );
-
-    endSingleTimeCommands(commandPool, commandBuffer, queue);
+    // no submit of its own, the transition goes out with the next copy recorded into the batch
+    uploads.barriers().image(image, 0, mipLevels, oldLayout, newLayout, srcStage, srcAccess, dstStage, dstAccess);
 }
 
 void VulkanApp::createImageView(CustomImageViewCreateInfo& customCreateInfo, VkImage& image, VkImageView& imageView)
@@ -339,7 +342,7 @@ void VulkanApp::createImageView(CustomImageViewCreateInfo& customCreateInfo, VkI
 void VulkanApp::createTextureImageView()
 {
     CustomImageViewCreateInfo customCreateInfo{};
-    customCreateInfo.format = VK_FORMAT_R8G8B8A8_SRGB;
+    customCreateInfo.format = textureFormat;
     customCreateInfo.levelCount = mipLevels;
 
     createImageView(customCreateInfo, textureImage, textureImageView);
@@ -0,0 +1,133 @@
+#include "thread_pool.hpp"
+
+#include <atomic>
+#include <exception>
+#include <memory>
+#include <algorithm>
+
+ThreadPool::ThreadPool(uint32_t threadCount)
+{
+    if (threadCount == 0)
+    {
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    workers.reserve(threadCount);
+    for (uint32_t i = 0; i < threadCount; ++i)
+    {
+        workers.emplace_back(&ThreadPool::workerLoop, this);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    condition.notify_all();
+
+    for (auto& worker : workers)
+    {
+        worker.join();
+    }
+}
+
+void ThreadPool::submit(std::function<void()> task)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        tasks.push_back(std::move(task));
+    }
+    condition.notify_one();
+}
+
+void ThreadPool::workerLoop()
+{
+    while (true)
+    {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            condition.wait(lock, [this] { return stopping || !tasks.empty(); });
+
+            if (stopping && tasks.empty())
+            {
+                return;
+            }
+
+            task = std::move(tasks.front());
+            tasks.pop_front();
+        }
+        task();
+    }
+}
+
+void ThreadPool::parallelFor(uint32_t count, const std::function<void(uint32_t)>& body)
+{
+    if (count == 0)
+    {
+        return;
+    }
+
+    struct SharedState
+    {
+        std::atomic<uint32_t> next{0};
+        std::atomic<bool> failed{false};
+        uint32_t remaining = 0;
+        std::exception_ptr error;
+        std::mutex mutex;
+        std::condition_variable done;
+    };
+
+    // helpers may be dequeued after the loop is over, so they hold the state on their own
+    // and never touch body once every index has been claimed
+    auto state = std::make_shared<SharedState>();
+    state->remaining = count;
+
+    auto drain = [state, count, &body]()
+    {
+        uint32_t i;
+        while ((i = state->next.fetch_add(1)) < count)
+        {
+            if (!state->failed)
+            {
+                try
+                {
+                    body(i);
+                }
+                catch (...)
+                {
+                    std::lock_guard<std::mutex> lock(state->mutex);
+                    if (!state->error)
+                    {
+                        state->error = std::current_exception();
+                    }
+                    state->failed = true;
+                }
+            }
+
+            std::lock_guard<std::mutex> lock(state->mutex);
+            if (--state->remaining == 0)
+            {
+                state->done.notify_one();
+            }
+        }
+    };
+
+    uint32_t helperCount = std::min(size(), count) - 1;
+    for (uint32_t i = 0; i < helperCount; ++i)
+    {
+        submit(drain);
+    }
+
+    drain();
+
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->done.wait(lock, [&state] { return state->remaining == 0; });
+
+    if (state->error)
+    {
+        std::rethrow_exception(state->error);
+    }
+}
\ No newline at end of file
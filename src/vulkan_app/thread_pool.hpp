@@ -0,0 +1,36 @@
+#pragma once
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <deque>
+#include <vector>
+#include <cstdint>
+
+class ThreadPool
+{
+public:
+    // threadCount == 0 picks the number of hardware threads
+    explicit ThreadPool(uint32_t threadCount = 0);
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+    ~ThreadPool();
+
+    uint32_t size() const { return static_cast<uint32_t>(workers.size()); }
+
+    void submit(std::function<void()> task);
+
+    // runs body(i) for every i in [0, count) and returns once all of them finished,
+    // the calling thread takes part in the work
+    void parallelFor(uint32_t count, const std::function<void(uint32_t)>& body);
+
+private:
+    void workerLoop();
+
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> tasks;
+    std::mutex mutex;
+    std::condition_variable condition;
+    bool stopping = false;
+};
\ No newline at end of file
@@ -0,0 +1,76 @@
+#include "vulkan_app.hpp"
+
+void VulkanApp::createTimestampQueries()
+{
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+
+    QueueFamilyIndices indices = findQueueFamilies(physicalDevice);
+
+    uint32_t queueFamilyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+    std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilies.data());
+
+    timestampValidBits = queueFamilies[indices.graphicsFamily.value()].timestampValidBits;
+    timestampPeriod = properties.limits.timestampPeriod;
+
+    if (timestampValidBits == 0)
+    {
+        SDL_Log("graphics queue does not support timestamps, gpu timings disabled");
+        return;
+    }
+
+    VkQueryPoolCreateInfo queryPoolInfo{};
+    queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    queryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    queryPoolInfo.queryCount = TIMESTAMPS_PER_FRAME * framesInFlight;
+
+    if (vkCreateQueryPool(device, &queryPoolInfo, nullptr, &timestampQueryPool) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create timestamp query pool!");
+    }
+
+    timestampsWritten.assign(framesInFlight, false);
+}
+
+void VulkanApp::writeTimestamp(VkCommandBuffer commandBuffer, VkPipelineStageFlagBits stage, uint32_t query)
+{
+    if (timestampQueryPool == VK_NULL_HANDLE)
+    {
+        return;
+    }
+
+    vkCmdWriteTimestamp(commandBuffer, stage, timestampQueryPool, currentFrame * TIMESTAMPS_PER_FRAME + query);
+}
+
+void VulkanApp::readTimestamps(uint32_t frame)
+{
+    if (timestampQueryPool == VK_NULL_HANDLE || !timestampsWritten[frame])
+    {
+        return;
+    }
+
+    // the frame has retired on the timeline, so the results are available without waiting
+    uint64_t timestamps[TIMESTAMPS_PER_FRAME];
+    VkResult result = vkGetQueryPoolResults(device, timestampQueryPool, frame * TIMESTAMPS_PER_FRAME, TIMESTAMPS_PER_FRAME,
+        sizeof(timestamps), timestamps, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+    timestampsWritten[frame] = false;
+
+    if (result == VK_SUCCESS)
+    {
+        uint64_t mask = timestampValidBits >= 64 ? UINT64_MAX : (1ull << timestampValidBits) - 1;
+        uint64_t ticks = (timestamps[1] - timestamps[0]) & mask;
+        gpuDrawTime += ticks * timestampPeriod * 1e-6;
+        ++gpuDrawSamples;
+    }
+
+    float time = getTime();
+    if (time - lastGpuTimeReport >= 1.f && gpuDrawSamples > 0)
+    {
+        SDL_Log("gpu draw time: %.3f ms (average of %u frames)", gpuDrawTime / gpuDrawSamples, gpuDrawSamples);
+        gpuDrawTime = 0.0;
+        gpuDrawSamples = 0;
+        lastGpuTimeReport = time;
+    }
+}
\ No newline at end of file
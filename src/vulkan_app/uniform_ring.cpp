@@ -0,0 +1,82 @@
+#include "uniform_ring.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+static VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+void UniformRing::init(VkPhysicalDevice physicalDevice, VkDevice device, MemoryAllocator& allocator, VkDeviceSize frameSize, uint32_t frameCount)
+{
+    this->device = device;
+    this->allocator = &allocator;
+    this->frameCount = frameCount;
+
+    VkPhysicalDeviceProperties deviceProperties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+    // a power of two, so every region starts aligned as well
+    alignment = std::max<VkDeviceSize>(deviceProperties.limits.minUniformBufferOffsetAlignment, 16);
+    this->frameSize = alignUp(frameSize, alignment);
+
+    // dynamic offsets are 32-bit
+    if (this->frameSize * frameCount > UINT32_MAX)
+    {
+        throw std::runtime_error("failed to fit uniform ring into 32-bit offsets!");
+    }
+
+    VkBufferCreateInfo bufferInfo{};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = this->frameSize * frameCount;
+    bufferInfo.usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    if (vkCreateBuffer(device, &bufferInfo, nullptr, &buffer) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create uniform ring buffer!");
+    }
+
+    VkMemoryRequirements memRequirements;
+    vkGetBufferMemoryRequirements(device, buffer, &memRequirements);
+
+    // coherent, the writes need no flush before the submission
+    memory = allocator.allocate(memRequirements, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, ResourceKind::Linear);
+    vkBindBufferMemory(device, buffer, memory.memory, memory.offset);
+}
+
+void UniformRing::cleanup()
+{
+    vkDestroyBuffer(device, buffer, nullptr);
+    allocator->free(memory);
+    buffer = VK_NULL_HANDLE;
+}
+
+void UniformRing::beginFrame(uint32_t slot)
+{
+    frameBegin = slot * frameSize;
+    head = frameBegin;
+}
+
+UniformAllocation UniformRing::allocate(VkDeviceSize size)
+{
+    VkDeviceSize offset = alignUp(head, alignment);
+    if (offset + size > frameBegin + frameSize)
+    {
+        throw std::runtime_error("failed to allocate from uniform ring, the frame ran out of space!");
+    }
+    head = offset + size;
+    peakBytes = std::max(peakBytes, head - frameBegin);
+
+    UniformAllocation allocation;
+    allocation.offset = static_cast<uint32_t>(offset);
+    allocation.mapped = static_cast<char*>(memory.mapped) + offset;
+    return allocation;
+}
+
+VkDeviceSize UniformRing::takePeakBytes()
+{
+    VkDeviceSize peak = peakBytes;
+    peakBytes = 0;
+    return peak;
+}
\ No newline at end of file
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <cstring>
+
+#include "memory_allocator.hpp"
+
+// uniform bytes each frame slot may hand out
+const VkDeviceSize UNIFORM_RING_FRAME_SIZE = 1 << 20;
+
+// a slice of the ring, its offset is the dynamic offset the descriptor is bound with
+struct UniformAllocation
+{
+    uint32_t offset;
+    void* mapped;
+};
+
+// linear allocator over one persistently mapped host-visible buffer, one region per frame slot;
+// the slices are bound through a UNIFORM_BUFFER_DYNAMIC descriptor, so any number of constant blocks
+// per frame costs neither allocations nor descriptor writes
+class UniformRing
+{
+public:
+    void init(VkPhysicalDevice physicalDevice, VkDevice device, MemoryAllocator& allocator, VkDeviceSize frameSize, uint32_t frameCount);
+    void cleanup();
+
+    // hands the slot's region out again from its start, the frame that used it last has to have retired;
+    // a frame that allocates in the same order gets the same offsets
+    void beginFrame(uint32_t slot);
+    // aligned to minUniformBufferOffsetAlignment
+    UniformAllocation allocate(VkDeviceSize size);
+
+    template<typename T>
+    uint32_t push(const T& data)
+    {
+        UniformAllocation allocation = allocate(sizeof(T));
+        memcpy(allocation.mapped, &data, sizeof(T));
+        return allocation.offset;
+    }
+
+    VkBuffer getBuffer() const { return buffer; }
+    // most bytes a frame used since the last call
+    VkDeviceSize takePeakBytes();
+
+private:
+    VkDevice device = VK_NULL_HANDLE;
+    MemoryAllocator* allocator = nullptr;
+
+    VkBuffer buffer = VK_NULL_HANDLE;
+    MemoryAllocation memory;
+    VkDeviceSize alignment = 256;
+    VkDeviceSize frameSize = 0;
+    uint32_t frameCount = 0;
+
+    VkDeviceSize frameBegin = 0;
+    VkDeviceSize head = 0;
+    VkDeviceSize peakBytes = 0;
+};
\ No newline at end of file
@@ -0,0 +1,338 @@
+#include "upload_context.hpp"
+
+#include <chrono>
+#include <stdexcept>
+
+static VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment)
+{
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+static void createStagingBuffer(VkDevice device, MemoryAllocator& allocator, VkDeviceSize size, VkBuffer& buffer, MemoryAllocation& allocation)
+{
+    VkBufferCreateInfo bufferInfo{};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = size;
+    bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    if (vkCreateBuffer(device, &bufferInfo, nullptr, &buffer) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create staging buffer!");
+    }
+
+    VkMemoryRequirements memRequirements;
+    vkGetBufferMemoryRequirements(device, buffer, &memRequirements);
+
+    allocation = allocator.allocate(memRequirements, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, ResourceKind::Linear);
+    vkBindBufferMemory(device, buffer, allocation.memory, allocation.offset);
+}
+
+void UploadContext::init(VkDevice device, MemoryAllocator& allocator, VkQueue queue, uint32_t queueFamily, VkDeviceSize stagingSize, bool batching,
+    PFN_vkCmdPipelineBarrier2KHR cmdPipelineBarrier2)
+{
+    this->device = device;
+    this->allocator = &allocator;
+    this->queue = queue;
+    this->batching = batching;
+    pendingBarriers.init(cmdPipelineBarrier2);
+
+    VkCommandPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT | VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+    poolInfo.queueFamilyIndex = queueFamily;
+
+    if (vkCreateCommandPool(device, &poolInfo, nullptr, &commandPool) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create upload command pool!");
+    }
+
+    // without a ring every staged upload gets a buffer of its own
+    ringSize = stagingSize;
+    if (ringSize > 0)
+    {
+        createStagingBuffer(device, allocator, ringSize, ringBuffer, ringMemory);
+    }
+}
+
+void UploadContext::cleanup()
+{
+    wait(flush());
+
+    for (auto& batch : freeBatches)
+    {
+        vkDestroyFence(device, batch.fence, nullptr);
+    }
+    freeBatches.clear();
+
+    vkDestroyCommandPool(device, commandPool, nullptr);
+    if (ringBuffer != VK_NULL_HANDLE)
+    {
+        vkDestroyBuffer(device, ringBuffer, nullptr);
+        allocator->free(ringMemory);
+    }
+}
+
+VkCommandBuffer UploadContext::commandBuffer()
+{
+    begin();
+
+    pendingBarriers.flush(current.commandBuffer);
+    stats.barrierCount = pendingBarriers.getBarrierCount();
+    stats.barrierBatchCount = pendingBarriers.getFlushCount();
+
+    return current.commandBuffer;
+}
+
+BarrierBatch& UploadContext::barriers()
+{
+    begin();
+    return pendingBarriers;
+}
+
+void UploadContext::begin()
+{
+    if (recording)
+    {
+        return;
+    }
+
+    if (!freeBatches.empty())
+    {
+        current = std::move(freeBatches.back());
+        freeBatches.pop_back();
+        vkResetCommandBuffer(current.commandBuffer, 0);
+    }
+    else
+    {
+        current = Batch{};
+
+        VkCommandBufferAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocInfo.commandPool = commandPool;
+        allocInfo.commandBufferCount = 1;
+
+        if (vkAllocateCommandBuffers(device, &allocInfo, &current.commandBuffer) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to allocate upload command buffer!");
+        }
+
+        VkFenceCreateInfo fenceInfo{};
+        fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+        if (vkCreateFence(device, &fenceInfo, nullptr, &current.fence) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create upload fence!");
+        }
+    }
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+    vkBeginCommandBuffer(current.commandBuffer, &beginInfo);
+    recording = true;
+}
+
+bool UploadContext::allocateFromRing(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& offset)
+{
+    if (ringUsed == 0)
+    {
+        ringHead = 0;
+        ringTail = 0;
+    }
+    else if (ringHead == ringTail)
+    {
+        return false;
+    }
+
+    // free space runs from the head to the tail, possibly wrapping around the end of the ring
+    VkDeviceSize start = alignUp(ringHead, alignment);
+    VkDeviceSize consumed;
+    if (ringHead >= ringTail && start + size <= ringSize)
+    {
+        consumed = start + size - ringHead;
+    }
+    else if (ringHead >= ringTail && size <= ringTail)
+    {
+        start = 0;
+        consumed = ringSize - ringHead + size;
+    }
+    else if (ringHead < ringTail && start + size <= ringTail)
+    {
+        consumed = start + size - ringHead;
+    }
+    else
+    {
+        return false;
+    }
+
+    ringHead = start + size;
+    ringUsed += consumed;
+    current.ringBytes += consumed;
+    current.ringEnd = ringHead;
+    offset = start;
+    return true;
+}
+
+StagingAllocation UploadContext::stage(VkDeviceSize size, VkDeviceSize alignment)
+{
+    begin();
+    stats.stagedBytes += size;
+
+    if (size > ringSize)
+    {
+        VkBuffer buffer;
+        MemoryAllocation allocation;
+        createStagingBuffer(device, *allocator, size, buffer, allocation);
+        current.largeBuffers.push_back(buffer);
+        current.largeAllocations.push_back(allocation);
+        return {buffer, 0, allocation.mapped};
+    }
+
+    // make room by retiring finished batches, submitting the current one or waiting for the oldest
+    VkDeviceSize offset;
+    while (!allocateFromRing(size, alignment, offset))
+    {
+        retireCompleted();
+        if (allocateFromRing(size, alignment, offset))
+        {
+            break;
+        }
+
+        if (!inFlight.empty())
+        {
+            waitOldest();
+        }
+        else
+        {
+            flush();
+            begin();
+        }
+    }
+
+    return {ringBuffer, offset, static_cast<uint8_t*>(ringMemory.mapped) + offset};
+}
+
+void UploadContext::endOperation()
+{
+    if (!batching)
+    {
+        wait(flush());
+    }
+}
+
+void UploadContext::signalOnFlush(VkSemaphore semaphore)
+{
+    begin();
+    current.signalSemaphores.push_back(semaphore);
+}
+
+void UploadContext::waitOnFlush(VkSemaphore semaphore, VkPipelineStageFlags stage)
+{
+    begin();
+    current.waitSemaphores.push_back(semaphore);
+    current.waitStages.push_back(stage);
+}
+
+UploadTicket UploadContext::flush()
+{
+    if (!recording)
+    {
+        return lastSubmitted;
+    }
+
+    // everything written here is visible to whatever reads it in later submissions,
+    // recorded along with the releases still pending
+    pendingBarriers.memory(VK_PIPELINE_STAGE_2_COPY_BIT | VK_PIPELINE_STAGE_2_BLIT_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT,
+        VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, VK_ACCESS_2_MEMORY_READ_BIT);
+    commandBuffer();
+
+    if (vkEndCommandBuffer(current.commandBuffer) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to record upload command buffer!");
+    }
+
+    VkSubmitInfo submitInfo{};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.waitSemaphoreCount = static_cast<uint32_t>(current.waitSemaphores.size());
+    submitInfo.pWaitSemaphores = current.waitSemaphores.data();
+    submitInfo.pWaitDstStageMask = current.waitStages.data();
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &current.commandBuffer;
+    submitInfo.signalSemaphoreCount = static_cast<uint32_t>(current.signalSemaphores.size());
+    submitInfo.pSignalSemaphores = current.signalSemaphores.data();
+
+    vkResetFences(device, 1, &current.fence);
+    if (vkQueueSubmit(queue, 1, &submitInfo, current.fence) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to submit uploads!");
+    }
+    ++stats.submissionCount;
+
+    current.ticket = ++lastSubmitted;
+    current.signalSemaphores.clear();
+    current.waitSemaphores.clear();
+    current.waitStages.clear();
+    inFlight.push_back(std::move(current));
+    current = Batch{};
+    recording = false;
+
+    return lastSubmitted;
+}
+
+bool UploadContext::isComplete(UploadTicket ticket)
+{
+    retireCompleted();
+    return ticket <= lastCompleted;
+}
+
+void UploadContext::wait(UploadTicket ticket)
+{
+    while (lastCompleted < ticket && !inFlight.empty())
+    {
+        waitOldest();
+    }
+}
+
+void UploadContext::retire(Batch& batch)
+{
+    if (batch.ringBytes > 0)
+    {
+        ringUsed -= batch.ringBytes;
+        ringTail = batch.ringEnd;
+    }
+
+    for (size_t i = 0; i < batch.largeBuffers.size(); ++i)
+    {
+        vkDestroyBuffer(device, batch.largeBuffers[i], nullptr);
+        allocator->free(batch.largeAllocations[i]);
+    }
+
+    lastCompleted = batch.ticket;
+
+    batch.ringBytes = 0;
+    batch.largeBuffers.clear();
+    batch.largeAllocations.clear();
+    freeBatches.push_back(std::move(batch));
+}
+
+void UploadContext::retireCompleted()
+{
+    while (!inFlight.empty() && vkGetFenceStatus(device, inFlight.front().fence) == VK_SUCCESS)
+    {
+        retire(inFlight.front());
+        inFlight.pop_front();
+    }
+}
+
+void UploadContext::waitOldest()
+{
+    auto start = std::chrono::high_resolution_clock::now();
+    vkWaitForFences(device, 1, &inFlight.front().fence, VK_TRUE, UINT64_MAX);
+    stats.waitMilliseconds += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+    retire(inFlight.front());
+    inFlight.pop_front();
+}
\ No newline at end of file
@@ -0,0 +1,131 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <deque>
+#include <vector>
+#include <cstdint>
+
+#include "memory_allocator.hpp"
+#include "barrier_batch.hpp"
+
+// identifies a flushed batch of uploads, batches complete in order
+using UploadTicket = uint64_t;
+
+// host-visible range the caller fills before recording a copy out of it
+struct StagingAllocation
+{
+    VkBuffer buffer;
+    VkDeviceSize offset;
+    void* mapped;
+};
+
+// image whose levels past the first are blitted from it on the graphics queue once it was acquired
+struct MipChain
+{
+    VkImage image;
+    VkFormat format;
+    int32_t width;
+    int32_t height;
+    uint32_t levels;
+};
+
+// resources one transfer batch released to the graphics queue, acquired there once the batch completed
+struct UploadHandoff
+{
+    UploadTicket ticket = 0;
+    // signaled by the transfer batch, only when the queue families differ
+    VkSemaphore semaphore = VK_NULL_HANDLE;
+    std::vector<VkBufferMemoryBarrier2> bufferBarriers;
+    std::vector<VkImageMemoryBarrier2> imageBarriers;
+    // generated right after the acquire, together with those of every other handoff acquired at once
+    std::vector<MipChain> mipChains;
+};
+
+struct UploadStats
+{
+    uint32_t submissionCount = 0;
+    VkDeviceSize stagedBytes = 0;
+    double waitMilliseconds = 0.0;
+    uint32_t barrierCount = 0;
+    uint32_t barrierBatchCount = 0;
+};
+
+// records copies, barriers and mip generation of many resources into one command buffer,
+// staging their data in a reusable ring, and submits them together with a single fence
+class UploadContext
+{
+public:
+    // without batching every operation is submitted and waited for on its own, as a baseline
+    void init(VkDevice device, MemoryAllocator& allocator, VkQueue queue, uint32_t queueFamily, VkDeviceSize stagingSize, bool batching,
+        PFN_vkCmdPipelineBarrier2KHR cmdPipelineBarrier2);
+    void cleanup();
+
+    // command buffer of the batch being recorded, the barriers collected so far are recorded into it first
+    VkCommandBuffer commandBuffer();
+    // barriers recorded ahead of the next command, so those of many resources end up in one call
+    BarrierBatch& barriers();
+    // the range lives until the batch it was taken from completes, record the copy out of it before endOperation
+    StagingAllocation stage(VkDeviceSize size, VkDeviceSize alignment = 16);
+    // marks the end of one upload, flushes and waits right away without batching
+    void endOperation();
+
+    // semaphores the batch being recorded signals or waits for when it is submitted
+    void signalOnFlush(VkSemaphore semaphore);
+    void waitOnFlush(VkSemaphore semaphore, VkPipelineStageFlags stage);
+
+    // submits the recorded batch, returns the ticket of the last submitted one
+    UploadTicket flush();
+    // ticket the batch being recorded will get
+    UploadTicket pendingTicket() const { return lastSubmitted + 1; }
+    bool isComplete(UploadTicket ticket);
+    void wait(UploadTicket ticket);
+
+    const UploadStats& getStats() const { return stats; }
+
+private:
+    struct Batch
+    {
+        VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+        VkFence fence = VK_NULL_HANDLE;
+        UploadTicket ticket = 0;
+        // ring bytes consumed, including space skipped when wrapping, and where they end
+        VkDeviceSize ringBytes = 0;
+        VkDeviceSize ringEnd = 0;
+        // staging buffers for uploads larger than the ring, released with the batch
+        std::vector<VkBuffer> largeBuffers;
+        std::vector<MemoryAllocation> largeAllocations;
+        std::vector<VkSemaphore> signalSemaphores;
+        std::vector<VkSemaphore> waitSemaphores;
+        std::vector<VkPipelineStageFlags> waitStages;
+    };
+
+    void begin();
+    bool allocateFromRing(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& offset);
+    void retire(Batch& batch);
+    void retireCompleted();
+    void waitOldest();
+
+    VkDevice device = VK_NULL_HANDLE;
+    MemoryAllocator* allocator = nullptr;
+    VkQueue queue = VK_NULL_HANDLE;
+    VkCommandPool commandPool = VK_NULL_HANDLE;
+    bool batching = true;
+    BarrierBatch pendingBarriers;
+
+    VkBuffer ringBuffer = VK_NULL_HANDLE;
+    MemoryAllocation ringMemory;
+    VkDeviceSize ringSize = 0;
+    VkDeviceSize ringHead = 0;
+    VkDeviceSize ringTail = 0;
+    VkDeviceSize ringUsed = 0;
+
+    bool recording = false;
+    Batch current;
+    std::deque<Batch> inFlight;
+    std::vector<Batch> freeBatches;
+
+    UploadTicket lastSubmitted = 0;
+    UploadTicket lastCompleted = 0;
+    UploadStats stats;
+};
\ No newline at end of file
@@ -0,0 +1,235 @@
+#include "vulkan_app.hpp"
+
+void VulkanApp::createUploadContexts()
+{
+    QueueFamilyIndices indices = findQueueFamilies(physicalDevice);
+    graphicsQueueFamily = indices.graphicsFamily.value();
+    transferQueueFamily = indices.transferFamily.value();
+
+    // copies stream on the transfer queue, acquires and mip blits run on the graphics queue without staging
+    transferUploads.init(device, memoryAllocator, transferQueue, transferQueueFamily, UPLOAD_STAGING_SIZE, options.uploadBatching, cmdPipelineBarrier2);
+    graphicsUploads.init(device, memoryAllocator, graphicsQueue, graphicsQueueFamily, 0, options.uploadBatching, cmdPipelineBarrier2);
+
+    if (transferQueueFamily != graphicsQueueFamily)
+    {
+        SDL_Log("uploads stream on dedicated transfer queue family %u", transferQueueFamily);
+    }
+    else
+    {
+        SDL_Log("no dedicated transfer queue family, uploads share the graphics queue");
+    }
+}
+
+VkSemaphore VulkanApp::getHandoffSemaphore()
+{
+    if (!freeHandoffSemaphores.empty())
+    {
+        VkSemaphore semaphore = freeHandoffSemaphores.back();
+        freeHandoffSemaphores.pop_back();
+        return semaphore;
+    }
+
+    VkSemaphoreCreateInfo semaphoreInfo{};
+    semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+    VkSemaphore semaphore;
+    if (vkCreateSemaphore(device, &semaphoreInfo, nullptr, &semaphore) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create upload handoff semaphore!");
+    }
+    return semaphore;
+}
+
+UploadHandoff& VulkanApp::currentUploadHandoff()
+{
+    UploadTicket ticket = transferUploads.pendingTicket();
+    if (uploadHandoffs.empty() || uploadHandoffs.back().ticket != ticket)
+    {
+        UploadHandoff handoff;
+        handoff.ticket = ticket;
+
+        if (transferQueueFamily != graphicsQueueFamily)
+        {
+            handoff.semaphore = getHandoffSemaphore();
+            transferUploads.signalOnFlush(handoff.semaphore);
+        }
+
+        uploadHandoffs.push_back(std::move(handoff));
+    }
+
+    return uploadHandoffs.back();
+}
+
+void VulkanApp::releaseBuffer(VkBuffer buffer)
+{
+    // on a single queue the barrier closing every batch already makes the copy visible
+    if (transferQueueFamily == graphicsQueueFamily)
+    {
+        return;
+    }
+
+    UploadHandoff& handoff = currentUploadHandoff();
+
+    VkBufferMemoryBarrier2 barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2;
+    barrier.srcStageMask = VK_PIPELINE_STAGE_2_COPY_BIT;
+    barrier.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+    barrier.dstStageMask = VK_PIPELINE_STAGE_2_NONE;
+    barrier.dstAccessMask = VK_ACCESS_2_NONE;
+    barrier.srcQueueFamilyIndex = transferQueueFamily;
+    barrier.dstQueueFamilyIndex = graphicsQueueFamily;
+    barrier.buffer = buffer;
+    barrier.offset = 0;
+    barrier.size = VK_WHOLE_SIZE;
+
+    // recorded with the other releases once the next copy or the flush comes
+    transferUploads.barriers().buffer(barrier);
+
+    // the acquire repeats the release after the semaphore wait at transfer,
+    // static buffers are read from any stage afterwards
+    barrier.srcAccessMask = VK_ACCESS_2_NONE;
+    barrier.dstStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+    barrier.dstAccessMask = VK_ACCESS_2_MEMORY_READ_BIT;
+    handoff.bufferBarriers.push_back(barrier);
+}
+
+void VulkanApp::releaseImage(VkImage image, VkImageLayout oldLayout, VkImageLayout newLayout, uint32_t mipLevels,
+    VkPipelineStageFlags2 dstStage, VkAccessFlags2 dstAccess)
+{
+    UploadHandoff& handoff = currentUploadHandoff();
+
+    VkImageMemoryBarrier2 barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2;
+    barrier.oldLayout = oldLayout;
+    barrier.newLayout = newLayout;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = image;
+    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    barrier.subresourceRange.baseMipLevel = 0;
+    barrier.subresourceRange.levelCount = mipLevels;
+    barrier.subresourceRange.baseArrayLayer = 0;
+    barrier.subresourceRange.layerCount = 1;
+    barrier.srcStageMask = VK_PIPELINE_STAGE_2_COPY_BIT;
+    barrier.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+
+    // the layout change happens once, the release and the acquire both describe it
+    if (transferQueueFamily != graphicsQueueFamily)
+    {
+        barrier.srcQueueFamilyIndex = transferQueueFamily;
+        barrier.dstQueueFamilyIndex = graphicsQueueFamily;
+        barrier.dstStageMask = VK_PIPELINE_STAGE_2_NONE;
+        barrier.dstAccessMask = VK_ACCESS_2_NONE;
+
+        transferUploads.barriers().image(barrier);
+
+        barrier.srcAccessMask = VK_ACCESS_2_NONE;
+    }
+
+    barrier.dstStageMask = dstStage;
+    barrier.dstAccessMask = dstAccess;
+    handoff.imageBarriers.push_back(barrier);
+}
+
+void VulkanApp::generateMipmapsOnAcquire(const MipChain& chain)
+{
+    currentUploadHandoff().mipChains.push_back(chain);
+}
+
+void VulkanApp::acquireUploads()
+{
+    transferUploads.flush();
+
+    // only batches that already completed are acquired, the graphics queue never waits for streaming
+    // the acquires of all of them go into one barrier, their mips are then generated together
+    std::vector<VkSemaphore> waitedSemaphores;
+    std::vector<MipChain> mipChains;
+    while (!uploadHandoffs.empty() && transferUploads.isComplete(uploadHandoffs.front().ticket))
+    {
+        UploadHandoff& handoff = uploadHandoffs.front();
+        BarrierBatch& barriers = graphicsUploads.barriers();
+
+        if (handoff.semaphore != VK_NULL_HANDLE)
+        {
+            graphicsUploads.waitOnFlush(handoff.semaphore, VK_PIPELINE_STAGE_TRANSFER_BIT);
+            waitedSemaphores.push_back(handoff.semaphore);
+        }
+
+        for (const auto& barrier : handoff.bufferBarriers)
+        {
+            barriers.buffer(barrier);
+        }
+        for (const auto& barrier : handoff.imageBarriers)
+        {
+            barriers.image(barrier);
+        }
+        mipChains.insert(mipChains.end(), handoff.mipChains.begin(), handoff.mipChains.end());
+
+        uploadHandoffs.pop_front();
+    }
+
+    if (!mipChains.empty())
+    {
+        generateMipmaps(graphicsUploads, mipChains);
+    }
+
+    // submitted ahead of the frame on the same queue, so the frame can use what was acquired
+    UploadTicket ticket = graphicsUploads.flush();
+
+    // a binary semaphore is signaled again only after the wait on it completed
+    for (VkSemaphore semaphore : waitedSemaphores)
+    {
+        waitedHandoffSemaphores.push_back({ticket, semaphore});
+    }
+    while (!waitedHandoffSemaphores.empty() && graphicsUploads.isComplete(waitedHandoffSemaphores.front().first))
+    {
+        freeHandoffSemaphores.push_back(waitedHandoffSemaphores.front().second);
+        waitedHandoffSemaphores.pop_front();
+    }
+
+    if (!assetsResident && uploadsResident(startupUploadTicket))
+    {
+        assetsResident = true;
+        // the frames so far only cleared
+        invalidateCommandBuffers();
+
+        const UploadStats& transferStats = transferUploads.getStats();
+        const UploadStats& graphicsStats = graphicsUploads.getStats();
+        SDL_Log("assets resident %.2f ms after startup began: %u transfer and %u graphics upload submissions, %.1f MiB staged, %u barriers in %u batches",
+            std::chrono::duration<float, std::chrono::milliseconds::period>(std::chrono::high_resolution_clock::now() - startupBegin).count(),
+            transferStats.submissionCount, graphicsStats.submissionCount, transferStats.stagedBytes / (1024.f * 1024.f),
+            transferStats.barrierCount + graphicsStats.barrierCount, transferStats.barrierBatchCount + graphicsStats.barrierBatchCount);
+    }
+}
+
+bool VulkanApp::uploadsResident(UploadTicket ticket)
+{
+    return transferUploads.isComplete(ticket) && (uploadHandoffs.empty() || uploadHandoffs.front().ticket > ticket);
+}
+
+void VulkanApp::cleanupUploadContexts()
+{
+    transferUploads.cleanup();
+    graphicsUploads.cleanup();
+
+    for (const auto& handoff : uploadHandoffs)
+    {
+        if (handoff.semaphore != VK_NULL_HANDLE)
+        {
+            vkDestroySemaphore(device, handoff.semaphore, nullptr);
+        }
+    }
+    uploadHandoffs.clear();
+
+    for (const auto& waited : waitedHandoffSemaphores)
+    {
+        vkDestroySemaphore(device, waited.second, nullptr);
+    }
+    waitedHandoffSemaphores.clear();
+
+    for (VkSemaphore semaphore : freeHandoffSemaphores)
+    {
+        vkDestroySemaphore(device, semaphore, nullptr);
+    }
+    freeHandoffSemaphores.clear();
+}
\ No newline at end of file
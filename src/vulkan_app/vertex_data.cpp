@@ -1 +1,81 @@
 #include "vertex_data.hpp"
+
+#include <glm/gtc/packing.hpp>
+
+#include <cmath>
+#include <cstring>
+
+uint32_t vertexStride(VertexFormat format)
+{
+    return format == VertexFormat::Compact ? sizeof(CompactVertex) : sizeof(Vertex);
+}
+
+uint32_t positionStride(VertexFormat format)
+{
+    return format == VertexFormat::Compact ? sizeof(CompactVertex::pos) : sizeof(Vertex::pos);
+}
+
+VkVertexInputBindingDescription getPositionBindingDescription(VertexFormat format)
+{
+    VkVertexInputBindingDescription bindingDescription{};
+    bindingDescription.binding = 0;
+    bindingDescription.stride = positionStride(format);
+    bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+    return bindingDescription;
+}
+
+VkVertexInputAttributeDescription getPositionAttributeDescription(VertexFormat format)
+{
+    VkVertexInputAttributeDescription attributeDescription{};
+    attributeDescription.binding = 0;
+    attributeDescription.location = 0;
+    attributeDescription.format = format == VertexFormat::Compact ? VK_FORMAT_R16G16B16A16_UNORM : VK_FORMAT_R32G32B32_SFLOAT;
+    attributeDescription.offset = 0;
+
+    return attributeDescription;
+}
+
+void extractPositions(VertexFormat format, const void* vertices, uint32_t vertexCount, std::vector<uint8_t>& positions)
+{
+    uint32_t stride = vertexStride(format);
+    uint32_t size = positionStride(format);
+    // pos is the first member of both layouts
+    auto source = static_cast<const uint8_t*>(vertices);
+
+    positions.resize(static_cast<size_t>(vertexCount) * size);
+    for (uint32_t i = 0; i < vertexCount; ++i)
+    {
+        memcpy(positions.data() + static_cast<size_t>(i) * size, source + static_cast<size_t>(i) * stride, size);
+    }
+}
+
+static uint16_t quantizeUnorm16(float value)
+{
+    float clamped = std::fmin(std::fmax(value, 0.f), 1.f);
+    return static_cast<uint16_t>(std::lround(clamped * 65535.f));
+}
+
+void compressVertices(const std::vector<Vertex>& vertices, const glm::vec3& boundsMin, const glm::vec3& boundsMax, std::vector<CompactVertex>& compactVertices)
+{
+    // a flat axis has no extent to spread the 16 bits over, every vertex sits at its minimum
+    glm::vec3 extent = boundsMax - boundsMin;
+    glm::vec3 invExtent;
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        invExtent[axis] = extent[axis] > 0.f ? 1.f / extent[axis] : 0.f;
+    }
+
+    compactVertices.reserve(compactVertices.size() + vertices.size());
+    for (const auto& vertex : vertices)
+    {
+        CompactVertex compact{};
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            compact.pos[axis] = quantizeUnorm16((vertex.pos[axis] - boundsMin[axis]) * invExtent[axis]);
+        }
+        compact.texCoord[0] = glm::packHalf1x16(vertex.texCoord.x);
+        compact.texCoord[1] = glm::packHalf1x16(vertex.texCoord.y);
+        compactVertices.push_back(compact);
+    }
+}
\ No newline at end of file
@@ -6,8 +6,17 @@
 #include <array>
 #include <vector>
 #include <cstddef> // for offsetof() macro
+#include <cstdint>
 
 #define ATTRIBUTES_COUNT 3
+#define COMPACT_ATTRIBUTES_COUNT 2
+
+// vertex layout the model is packed into, chosen at load time
+enum class VertexFormat : uint32_t
+{
+    Full = 0,
+    Compact = 1
+};
 
 struct Vertex
 {
@@ -46,4 +55,48 @@ struct Vertex
 
         return attributeDescriptions;
     }
-};
\ No newline at end of file
+};
+
+// 12 byte vertex: position quantized to the bounds of its mesh, texture coordinates as half floats.
+// the vertex shader scales positions back with the per-mesh offset and scale
+struct CompactVertex
+{
+    uint16_t pos[4];
+    uint16_t texCoord[2];
+
+    static VkVertexInputBindingDescription getBindingDescription()
+    {
+        VkVertexInputBindingDescription bindingDescription{};
+        bindingDescription.binding = 0;
+        bindingDescription.stride = sizeof(CompactVertex);
+        bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+        return bindingDescription;
+    }
+
+    static std::array<VkVertexInputAttributeDescription, COMPACT_ATTRIBUTES_COUNT> getAttributeDescriptions()
+    {
+        std::array<VkVertexInputAttributeDescription, COMPACT_ATTRIBUTES_COUNT> attributeDescriptions{};
+
+        attributeDescriptions[0].binding = 0;
+        attributeDescriptions[0].location = 0;
+        attributeDescriptions[0].format = VK_FORMAT_R16G16B16A16_UNORM;
+        attributeDescriptions[0].offset = offsetof(CompactVertex, pos);
+
+        attributeDescriptions[1].binding = 0;
+        attributeDescriptions[1].location = 2;
+        attributeDescriptions[1].format = VK_FORMAT_R16G16_SFLOAT;
+        attributeDescriptions[1].offset = offsetof(CompactVertex, texCoord);
+
+        return attributeDescriptions;
+    }
+};
+
+uint32_t vertexStride(VertexFormat format);
+
+// tightly packed position-only stream for depth and shadow pipelines, in the position format of the vertex layout
+uint32_t positionStride(VertexFormat format);
+VkVertexInputBindingDescription getPositionBindingDescription(VertexFormat format);
+VkVertexInputAttributeDescription getPositionAttributeDescription(VertexFormat format);
+void extractPositions(VertexFormat format, const void* vertices, uint32_t vertexCount, std::vector<uint8_t>& positions);
+void compressVertices(const std::vector<Vertex>& vertices, const glm::vec3& boundsMin, const glm::vec3& boundsMax, std::vector<CompactVertex>& compactVertices);
\ No newline at end of file
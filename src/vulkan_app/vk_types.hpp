@@ -71,7 +71,32 @@ struct CustomImageViewCreateInfo
     uint32_t layerCount     = 1;
 };
 
+// camera of the frame, projection and view combined once on the cpu
 struct UniformBufferObject
+{
+    glm::mat4 viewProj;
+};
+
+// 16 KiB, the smallest maxUniformBufferRange a device may have
+const uint32_t MAX_SCENE_OBJECTS = 256;
+
+// model matrices of the frame, one per mesh, a draw picks its own with the index it pushes
+struct ObjectTransforms
+{
+    glm::mat4 models[MAX_SCENE_OBJECTS];
+};
+
+// multi-draws cannot push per draw, their objects are picked by the instance index, which is the mesh index
+const uint32_t OBJECT_INDEX_FROM_INSTANCE = 0xffffffff;
+
+// push constants of the vertex stages
+struct DrawConstants
+{
+    uint32_t objectIndex;
+};
+
+// matrices the cpu culls and selects levels of detail with
+struct FrameTransforms
 {
     glm::mat4 model;
     glm::mat4 view;
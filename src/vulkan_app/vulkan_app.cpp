@@ -9,30 +9,62 @@ void VulkanApp::initWindow()
 
 void VulkanApp::initVulkan() 
 {
+    startupBegin = std::chrono::high_resolution_clock::now();
+
     createInstance();
     setupDebugMessenger();
     createSurface();
     pickPhysicalDevice();
     createLogicalDevice();
+    memoryAllocator.init(physicalDevice, device);
+    deletionQueue.init(device, &memoryAllocator);
+    pipelineCache.init(physicalDevice, device, PIPELINE_CACHE_PATH, options.coldPipelineCache);
     createSwapChain();
     createImageViews();
     createRenderPass();
     createDescriptorSetLayout();
     createGraphicsPipeline();
     createCommandPools();
-    createDepthResources();
-    createFramebuffers();
+    createUploadContexts();
     createTextureImage();
     createTextureImageView();
     createTextureSampler();
     loadModel();
     createVertexBuffer();
     createIndexBuffer();
+    createIndirectBuffer();
+    createMeshDataBuffer();
+    createClusterCulling();
+    createLodSelection();
+    // the graph depends on the culling mode
+    createRenderGraph();
+    createFramebuffers();
     createUniformBuffers();
     createDescriptorPool();
     createDescriptorSets();
     createCommandBuffers();
+    createRecordingPools();
     createSyncObjects();
+    createTimestampQueries();
+
+    // the frames pick the uploads up as they complete instead of waiting for them here
+    startupUploadTicket = transferUploads.flush();
+    graphicsUploads.flush();
+
+    auto startupEnd = std::chrono::high_resolution_clock::now();
+    const UploadStats& uploadStats = transferUploads.getStats();
+    SDL_Log("startup: %.2f ms, %u upload submissions%s, %.1f MiB staged, %.2f ms waiting for uploads",
+        std::chrono::duration<float, std::chrono::milliseconds::period>(startupEnd - startupBegin).count(),
+        uploadStats.submissionCount, options.uploadBatching ? "" : " (unbatched)",
+        uploadStats.stagedBytes / (1024.f * 1024.f), uploadStats.waitMilliseconds);
+
+    PipelineCacheStats pipelineStats = pipelineCache.getStats();
+    PipelineLibraryStats libraryStats = pipelineLibrary.getStats();
+    uint32_t pipelinesCompiling = libraryStats.requestCount - libraryStats.deduplicatedCount - libraryStats.compiledCount - libraryStats.failedCount;
+    SDL_Log("pipelines: %u created in %.2f ms with a %s cache, %u still compiling on the workers, %u shader variants built", pipelineStats.pipelineCount,
+        pipelineStats.creationMilliseconds, pipelineCache.isWarm() ? "warm" : "cold", pipelinesCompiling, shaderVariants.getVariantCount());
+
+    logMemoryStats("after startup");
 }
 
 void VulkanApp::mainLoop() 
@@ -54,7 +86,9 @@ void VulkanApp::mainLoop()
             {
                 if (windowEvent.window.event == SDL_WINDOWEVENT_SIZE_CHANGED)
                 {
+                    // bursts of events while dragging collapse into one rebuild
                     framebufferResized = true;
+                    lastResizeEvent = getTime();
                 }
             }
         }
@@ -71,40 +105,64 @@ void VulkanApp::mainLoop()
 void VulkanApp::cleanup() 
 {
     cleanupSwapChain();
+    // the device is idle, nothing retired is in use anymore
+    deletionQueue.flush();
+    // waits for the workers still compiling, before anything they build from is destroyed
+    pipelineLibrary.cleanup();
 
     vkDestroySampler(device, textureSampler, nullptr);
     vkDestroyImageView(device, textureImageView, nullptr);
 
     vkDestroyImage(device, textureImage, nullptr);
-    vkFreeMemory(device, textureImageMemory, nullptr);
+    memoryAllocator.free(textureImageMemory);
 
-    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i)
-    {
-        vkDestroyBuffer(device, uniformBuffers[i], nullptr);
-        vkFreeMemory(device, uniformBuffersMemory[i], nullptr);
-    }
+    uniformRing.cleanup();
 
     vkDestroyDescriptorPool(device, descriptorPool, nullptr);
     vkDestroyDescriptorSetLayout(device, descriptorSetLayout, nullptr);
 
     vkDestroyBuffer(device, vertexBuffer, nullptr);
-    vkFreeMemory(device, vertexBufferMemory, nullptr);
+    memoryAllocator.free(vertexBufferMemory);
+
+    vkDestroyBuffer(device, positionBuffer, nullptr);
+    memoryAllocator.free(positionBufferMemory);
+
+    vkDestroyBuffer(device, indexBuffer16, nullptr);
+    memoryAllocator.free(indexBuffer16Memory);
+
+    vkDestroyBuffer(device, indexBuffer32, nullptr);
+    memoryAllocator.free(indexBuffer32Memory);
+
+    vkDestroyBuffer(device, meshDataBuffer, nullptr);
+    memoryAllocator.free(meshDataBufferMemory);
 
-    vkDestroyBuffer(device, indexBuffer, nullptr);
-    vkFreeMemory(device, indexBufferMemory, nullptr);
+    vkDestroyBuffer(device, indirectBuffer, nullptr);
+    memoryAllocator.free(indirectBufferMemory);
 
-    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i)
+    cleanupClusterCulling();
+    cleanupLodSelection();
+
+    cleanupUploadContexts();
+
+    logMemoryStats("at shutdown");
+    memoryAllocator.cleanup();
+
+    meshCache.close();
+
+    for (size_t i = 0; i < framesInFlight; ++i)
     {
         vkDestroySemaphore(device, imageAvailableSemaphores[i], nullptr);
         vkDestroySemaphore(device, renderFinishedSemaphores[i], nullptr);
-        vkDestroyFence(device, inFlightFences[i], nullptr);
     }
+    frameScheduler.cleanup();
+
+    vkDestroyQueryPool(device, timestampQueryPool, nullptr);
 
-    vkDestroyPipeline(device, graphicsPipeline, nullptr);
     vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
     vkDestroyRenderPass(device, renderPass, nullptr);
+    cleanupRecordingPools();
     vkDestroyCommandPool(device, graphicsCommandPool, nullptr);
-    vkDestroyCommandPool(device, transferCommandPool, nullptr);
+    pipelineCache.cleanup();
     vkDestroyDevice(device, nullptr);
 
     if (enableValidationLayers)
@@ -124,6 +182,15 @@ void VulkanApp::run()
 {
     initWindow();
     initVulkan();
-    mainLoop();
+    if (options.benchRecording)
+    {
+        runRecordingBenchmark();
+        // the startup uploads may still be running
+        vkDeviceWaitIdle(device);
+    }
+    else
+    {
+        mainLoop();
+    }
     cleanup();
 }
\ No newline at end of file
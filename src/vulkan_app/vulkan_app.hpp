@@ -25,9 +25,20 @@
 
 #include "load_shader.hpp"
 #include "load_model.hpp"
+#include "mesh_cache.hpp"
 #include "vertex_data.hpp"
 #include "common.hpp"
 #include "vk_types.hpp"
+#include "app_options.hpp"
+#include "thread_pool.hpp"
+#include "memory_allocator.hpp"
+#include "upload_context.hpp"
+#include "frame_scheduler.hpp"
+#include "deletion_queue.hpp"
+#include "render_graph.hpp"
+#include "pipeline_cache.hpp"
+#include "pipeline_library.hpp"
+#include "uniform_ring.hpp"
 
 #ifdef _WIN32
     #pragma comment(linker, "/subsystem:windows")
@@ -37,7 +48,16 @@
 
 const uint32_t WIDTH = 800;
 const uint32_t HEIGHT = 600;
-const int MAX_FRAMES_IN_FLIGHT = 2;
+// begin and end of the scene draws
+const uint32_t TIMESTAMPS_PER_FRAME = 2;
+// staging ring shared by all uploads, larger uploads get a buffer of their own
+const VkDeviceSize UPLOAD_STAGING_SIZE = 32 * 1024 * 1024;
+// a resize is applied once the window size stopped changing for this long
+const float RESIZE_SETTLE_SECONDS = 0.1f;
+// secondaries per recording chunk and frame, the depth prepass and the shading pass
+const uint32_t RECORD_PASSES = 2;
+// smaller draw lists are not worth handing to another thread
+const uint32_t RECORD_MIN_DRAWS_PER_CHUNK = 256;
 
 const std::vector<const char*> validationLayers = 
 {
@@ -46,7 +66,8 @@ const std::vector<const char*> validationLayers =
 
 const std::vector<const char*> deviceExtensions =
 {
-    VK_KHR_SWAPCHAIN_EXTENSION_NAME
+    VK_KHR_SWAPCHAIN_EXTENSION_NAME,
+    VK_KHR_SYNCHRONIZATION_2_EXTENSION_NAME
 };
 
 #ifdef NDEBUG
@@ -69,6 +90,9 @@ void DestroyDebugUtilsMessengerEXT(
 class VulkanApp 
 {
 public:
+    explicit VulkanApp(const AppOptions& options = {}) :
+        options(options), threadPool(options.workerThreads), framesInFlight(options.framesInFlight) {}
+
     void run();
 
 private:
@@ -106,56 +130,116 @@ private:
 
     void createCommandPools();
     void createCommandBuffers();
+    void invalidateCommandBuffers();
+    VkCommandBuffer prepareGraphicsCommandBuffer(uint32_t imageIndex);
     void recordGraphicsCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex);
-    VkCommandBuffer beginSingleTimeCommands(VkCommandPool commandPool);
-    void endSingleTimeCommands(VkCommandPool commandPool, VkCommandBuffer commandBuffer, VkQueue queue);
+    void recordScenePass(VkCommandBuffer commandBuffer);
+    // picks the object transforms the following draws are placed with
+    void pushDrawConstants(VkCommandBuffer commandBuffer, uint32_t objectIndex);
+    void recordMeshDraws(VkCommandBuffer commandBuffer);
+    void recordMeshDraws(VkCommandBuffer commandBuffer, VkIndexType indexType, uint32_t firstMesh, uint32_t meshCount);
+
+    void createRecordingPools();
+    void cleanupRecordingPools();
+    void beginSecondaryCommandBuffer(VkCommandBuffer commandBuffer, VkFramebuffer framebuffer);
+    void bindPassState(VkCommandBuffer commandBuffer, VkPipeline pipeline, VkBuffer vertexStream);
+    void recordSceneParallel(VkCommandBuffer commandBuffer, uint32_t imageIndex);
+    void runRecordingBenchmark();
 
     void createSyncObjects();
+    void reportFrameStats();
     void drawFrame();
 
-    uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
-    void createBuffer(CustomBufferCreateInfo& customBufferInfo, VkBuffer& buffer, VkDeviceMemory& bufferMemory);
-    void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size);
+    void createBuffer(CustomBufferCreateInfo& customBufferInfo, VkBuffer& buffer, MemoryAllocation& bufferMemory);
+    void copyBuffer(VkBuffer srcBuffer, VkDeviceSize srcOffset, VkBuffer dstBuffer, VkDeviceSize size);
+    void createDeviceLocalBuffer(const void* data, VkDeviceSize size, VkBufferUsageFlags usage, VkBuffer& buffer, MemoryAllocation& bufferMemory);
     void createVertexBuffer();
     void createIndexBuffer();
+    void createIndirectBuffer();
+    void createMeshDataBuffer();
     void createUniformBuffers();
     void updateUniformBuffer(uint32_t currentImage);
 
-    void createImage(CustomImageCreateInfo& customImageInfo, VkImage& image, VkDeviceMemory& imageMemory);
-    void copyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height);
+    void createImage(CustomImageCreateInfo& customImageInfo, VkImage& image, MemoryAllocation& imageMemory);
+    void copyBufferToImage(VkBuffer buffer, VkDeviceSize bufferOffset, VkImage image, uint32_t width, uint32_t height);
+    void copyBufferToImage(VkBuffer buffer, VkImage image, const std::vector<VkBufferImageCopy>& regions);
     void createTextureImage();
-    void transitionImageLayout(VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout, uint32_t mipLevels = 1);
+    bool loadCookedTexture();
+    void transitionImageLayout(UploadContext& uploads, VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout, uint32_t mipLevels = 1);
     void createImageView(CustomImageViewCreateInfo& createInfo, VkImage& image, VkImageView& imageView);
     void createTextureImageView();
     void createTextureSampler();
-    void generateMipmaps(VkImage image, VkFormat format, int32_t texWidth, int32_t texHeight, uint32_t mipLevels);
+    void generateMipmaps(UploadContext& uploads, const std::vector<MipChain>& chains);
 
     void loadModel();
 
     VkFormat findSupportedFormat(const std::vector<VkFormat>& candidates, VkImageTiling tiling, VkFormatFeatureFlags features);
-    void createDepthResources();
+    void createRenderGraph();
     VkFormat findDepthFormat();
 
     void beginTimer();
     float getTime();
 
+    void createTimestampQueries();
+    void writeTimestamp(VkCommandBuffer commandBuffer, VkPipelineStageFlagBits stage, uint32_t query);
+    void readTimestamps(uint32_t frame);
+
+    void createClusterCulling();
+    void createCullPipeline();
+    void cullClustersCpu(uint32_t frame);
+    void recordClusterCulling(VkCommandBuffer commandBuffer);
+    void recordClusterDraws(VkCommandBuffer commandBuffer);
+    void recordIndirectDraws(VkCommandBuffer commandBuffer, VkIndexType indexType, VkBuffer drawBuffer, uint32_t firstDraw, uint32_t drawCount);
+    void readCullStats(uint32_t frame);
+    void addCullStats(uint32_t tested, uint32_t visible);
+    void cleanupClusterCulling();
+
+    void createLodSelection();
+    void selectMeshLods(uint32_t frame);
+    void addSubmittedTriangles(uint64_t triangles);
+    void cleanupLodSelection();
+
+    void logMemoryStats(const char* when);
+
+    void createUploadContexts();
+    VkSemaphore getHandoffSemaphore();
+    UploadHandoff& currentUploadHandoff();
+    void releaseBuffer(VkBuffer buffer);
+    void releaseImage(VkImage image, VkImageLayout oldLayout, VkImageLayout newLayout, uint32_t mipLevels,
+        VkPipelineStageFlags2 dstStage, VkAccessFlags2 dstAccess);
+    void generateMipmapsOnAcquire(const MipChain& chain);
+    void acquireUploads();
+    bool uploadsResident(UploadTicket ticket);
+    void cleanupUploadContexts();
+
     void initWindow();
     void initVulkan();
     void mainLoop();
     void cleanup();
+
+    AppOptions options;
+    ThreadPool threadPool;
+    // depth of every per-frame resource, fixed at startup
+    uint32_t framesInFlight;
     
     SDL_Window* window;
     VkInstance instance;
     VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
     VkDevice device;
+    MemoryAllocator memoryAllocator;
+    // resources replaced at runtime outlive the frames still using them
+    DeletionQueue deletionQueue;
+    // every pipeline is created through it
+    PipelineCache pipelineCache;
 
     VkQueue graphicsQueue;
     VkQueue presentQueue;
     VkQueue transferQueue;
+    PFN_vkCmdPipelineBarrier2KHR cmdPipelineBarrier2 = nullptr;
 
     VkDebugUtilsMessengerEXT debugMessenger;
     VkSurfaceKHR surface;
-    VkSwapchainKHR swapChain;
+    VkSwapchainKHR swapChain = VK_NULL_HANDLE;
     std::vector<VkImage> swapChainImages;
     VkFormat swapChainImageFormat;
     VkExtent2D swapChainExtent;
@@ -164,46 +248,144 @@ private:
     VkDescriptorSetLayout descriptorSetLayout;
     VkPipelineLayout pipelineLayout;
     VkRenderPass renderPass;
-    VkPipeline graphicsPipeline;
+    ShaderVariants shaderVariants;
+    PipelineLibrary pipelineLibrary;
+    PipelineHandle scenePipeline = 0;
+    // only with --depth-prepass, the frames skip the pre-pass while it compiles
+    std::optional<PipelineHandle> depthPrepassPipeline;
     std::vector<VkFramebuffer> swapChainFramebuffers;
     
     VkCommandPool graphicsCommandPool;
-    VkCommandPool transferCommandPool;
 
     VkDescriptorPool descriptorPool;
     std::vector<VkDescriptorSet> descriptorSets;
 
     std::vector<VkCommandBuffer> graphicsCommandBuffers;
 
+    // recorded once per frame slot and swapchain image, replayed until the scene version moves on
+    bool commandCaching = false;
+    uint64_t sceneVersion = 1;
+    std::vector<std::vector<VkCommandBuffer>> cachedCommandBuffers;
+    std::vector<std::vector<uint64_t>> cachedCommandVersions;
+    uint32_t recordedCommandBuffers = 0;
+    double recordMilliseconds = 0.0;
+
+    // parallel recording, indexed by frame slot then chunk
+    uint32_t recordChunkCount = 0;
+    std::vector<VkCommandPool> recordCommandPools;
+    std::vector<VkCommandBuffer> recordCommandBuffers;
+
     //synchronization
+    FrameScheduler frameScheduler;
+    // slot of the frame being recorded
     uint32_t currentFrame = 0;
     std::vector<VkSemaphore> imageAvailableSemaphores;
     std::vector<VkSemaphore> renderFinishedSemaphores;
-    std::vector<VkFence> inFlightFences;
+    float lastFrameReport = 0.f;
 
-    std::vector<Vertex> vertices;
-    std::vector<uint32_t> indices;
+    MeshCache meshCache;
+    PackedGeometry geometry;
+    GeometryView geometryView;
+    std::vector<MeshRange> meshRanges;
 
     VkBuffer vertexBuffer;
-    VkDeviceMemory vertexBufferMemory;
-    VkBuffer indexBuffer;
-    VkDeviceMemory indexBufferMemory;
-
-    std::vector<VkBuffer> uniformBuffers;
-    std::vector<VkDeviceMemory> uniformBuffersMemory;
-    std::vector<void*> uniformBuffersMapped;
-
+    MemoryAllocation vertexBufferMemory;
+    VkBuffer positionBuffer = VK_NULL_HANDLE;
+    MemoryAllocation positionBufferMemory;
+    VkBuffer indexBuffer16 = VK_NULL_HANDLE;
+    MemoryAllocation indexBuffer16Memory;
+    VkBuffer indexBuffer32 = VK_NULL_HANDLE;
+    MemoryAllocation indexBuffer32Memory;
+    // ranges are sorted by index type, 16-bit meshes first
+    uint32_t meshCount16 = 0;
+    VkBuffer meshDataBuffer;
+    MemoryAllocation meshDataBufferMemory;
+
+    bool multiDrawIndirectSupported = false;
+    VkBuffer indirectBuffer = VK_NULL_HANDLE;
+    MemoryAllocation indirectBufferMemory;
+
+    UniformRing uniformRing;
+    // dynamic offsets of the frame's camera and object transforms in the ring, in binding order
+    std::array<uint32_t, 2> frameUniformOffsets{};
+
+    bool textureCompressionBCSupported = false;
     VkImage textureImage;
+    VkFormat textureFormat = VK_FORMAT_R8G8B8A8_SRGB;
     uint32_t mipLevels;
-    VkDeviceMemory textureImageMemory;
+    MemoryAllocation textureImageMemory;
     VkImageView textureImageView;
     VkSampler textureSampler;
 
-    VkImage depthImage;
-    VkDeviceMemory depthImageMemory;
-    VkImageView depthImageView;
+    // rebuilt with the swapchain, owns the depth buffer as a transient
+    RenderGraph renderGraph;
+    RenderResource swapChainResource = 0;
+    RenderResource depthResource = 0;
+    RenderResource clusterDrawResource = 0;
+    RenderResource cullStatsResource = 0;
+    // swapchain image the graph's passes are recorded for
+    uint32_t recordImageIndex = 0;
 
     bool framebufferResized = false;
+    float lastResizeEvent = 0.f;
+
+    VkQueryPool timestampQueryPool = VK_NULL_HANDLE;
+    uint32_t timestampValidBits = 0;
+    float timestampPeriod = 1.f;
+    std::vector<bool> timestampsWritten;
+    double gpuDrawTime = 0.0;
+    uint32_t gpuDrawSamples = 0;
+    float lastGpuTimeReport = 0.f;
+
+    // matrices of the frame being recorded, shared with the cluster culling
+    FrameTransforms frameTransforms{};
+
+    ClusterCulling clusterCulling = ClusterCulling::Off;
+    // meshlets of 16-bit meshes come first
+    uint32_t meshletCount16 = 0;
+    VkBuffer meshletBuffer = VK_NULL_HANDLE;
+    MemoryAllocation meshletBufferMemory;
+    std::vector<VkBuffer> clusterDrawBuffers;
+    std::vector<MemoryAllocation> clusterDrawBuffersMemory;
+    std::vector<void*> clusterDrawBuffersMapped;
+    // visible 16-bit and 32-bit draws written by the cpu culling
+    std::vector<std::array<uint32_t, 2>> clusterDrawCounts;
+    std::vector<VkBuffer> cullStatsBuffers;
+    std::vector<MemoryAllocation> cullStatsBuffersMemory;
+    std::vector<void*> cullStatsBuffersMapped;
+    std::vector<bool> cullStatsWritten;
+    VkDescriptorSetLayout cullDescriptorSetLayout = VK_NULL_HANDLE;
+    VkDescriptorPool cullDescriptorPool = VK_NULL_HANDLE;
+    std::vector<VkDescriptorSet> cullDescriptorSets;
+    VkPipelineLayout cullPipelineLayout = VK_NULL_HANDLE;
+    VkPipeline cullPipeline = VK_NULL_HANDLE;
+    uint64_t clustersTested = 0;
+    uint64_t clustersCulled = 0;
+    float lastCullReport = 0.f;
+
+    bool lodSelection = false;
+    // level of detail drawn for every mesh, per frame in flight
+    std::vector<std::vector<uint32_t>> selectedLods;
+    std::vector<VkBuffer> lodDrawBuffers;
+    std::vector<MemoryAllocation> lodDrawBuffersMemory;
+    std::vector<void*> lodDrawBuffersMapped;
+    uint64_t trianglesSubmitted = 0;
+    uint32_t triangleFrames = 0;
+    float lastTriangleReport = 0.f;
+
+    uint32_t graphicsQueueFamily = 0;
+    uint32_t transferQueueFamily = 0;
+    UploadContext transferUploads;
+    UploadContext graphicsUploads;
+    // released by the transfer queue and not yet acquired by the graphics queue, oldest first
+    std::deque<UploadHandoff> uploadHandoffs;
+    // handoff semaphores with the graphics upload that waited on them
+    std::deque<std::pair<UploadTicket, VkSemaphore>> waitedHandoffSemaphores;
+    std::vector<VkSemaphore> freeHandoffSemaphores;
+    // draws start once everything uploaded during startup is resident, frames keep presenting until then
+    UploadTicket startupUploadTicket = 0;
+    bool assetsResident = false;
+    std::chrono::high_resolution_clock::time_point startupBegin;
 
     std::chrono::_V2::system_clock::time_point startTime;
 };
\ No newline at end of file